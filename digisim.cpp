@@ -19,25 +19,50 @@
 //              Please note any inefficiencies and report to hjwilson@caltech.edu
 //
 // Table of Contents:
-// 		Line 85   :     Enumerated type logic values for the circuit. These logic values are present on all circuit nodes. 
-// 		Line 95   :     class Node defines Node objects for the circuit. 
-//      Line 139  :     class Component defines base level Component objects for the circuit.
-//      Line 158  :     class ComboLogicGate defines the child class for Combinatorial gates within Component. 
-//      Line 177  :     class DFF defines the child class of DFF gates within Component. 
-//		Line 239  :     class ANDgate defines the child class of AND gate within ComboLogicGate. 
-//		Line 340  :     class ORgate defines the child class for OR gate within ComboLogicGate. 
-//		Line 442  :     class XORgate defines the child class for XOR gate within ComboLogicGate. 
-//		Line 543  :     class NANDgate defines the child class for NAND gate within ComboLogicGate.
-//		Line 646  :     class NORgate defines the child class for NOR gate within ComboLogicGate.
-//		Line 749  :     class XNORgate defines the child class for XNOR gate within ComboLogicGate.
-//		Line 858  :     class Event defines Event objects for the Event Queue used in simulators. 
-//		Line 877  :     struct LessThanTime defines the Event Queue time comparator between Events.
-//		Line 889  :     class EventQueue defines Event Queue objects for the simulators. 
-//		Line 945  :     class Circuit defines the Circuit object for the simulators. Describes top level connections. 
-//		Line 1166 :     Circuit:Function Timing Simulation defines the process of running a timing simulation.
-//		Line 1333 :     Circuit:Function Functional Simulation defines the process of running a functional simulation. 
-//		Line 1725 :     class FaultVectorGenerator defines the Fault Vector Generator for generating Fault Vectors. 
-//		Line 1911 :     main()
+// 		Line 124  :     Enumerated type logic values for the circuit. These logic values are present on all circuit nodes. 
+// 		Line 137  :     class Node defines Node objects for the circuit. 
+//      Line 187  :     class Component defines base level Component objects for the circuit.
+//      Line 212  :     class ComboLogicGate defines the child class for Combinatorial gates within Component. 
+//      Line 231  :     class DFF defines the child class of DFF gates within Component. 
+//		Line 310  :     class ANDgate defines the child class of AND gate within ComboLogicGate. 
+//		Line 410  :     class ORgate defines the child class for OR gate within ComboLogicGate. 
+//		Line 511  :     class XORgate defines the child class for XOR gate within ComboLogicGate. 
+//		Line 611  :     class NANDgate defines the child class for NAND gate within ComboLogicGate.
+//		Line 713  :     class NORgate defines the child class for NOR gate within ComboLogicGate.
+//		Line 815  :     class XNORgate defines the child class for XNOR gate within ComboLogicGate.
+//		Line 915  :     Text File Parsing defines the memory-mapped tokenizer used to read netlists and input files. 
+//		Line 1043 :     Netlist Images defines the binary netlist image files read in place of netlist text. 
+//		Line 1193 :     class ClockSource defines the periodic clock generators declared in netlists (.CLOCK). 
+//		Line 1240 :     class StimulusStream defines the time-ordered stimulus reader merged into the Event Queue. 
+//		Line 1440 :     class Event defines Event objects for the Event Queue used in simulators. 
+//		Line 1463 :     struct LessThanTime defines the Event Queue time comparator between Events.
+//		Line 1488 :     class EventQueue defines Event Queue objects for the simulators. 
+//		Line 1734 :     class SymbolTable defines the interned name-to-index table used to resolve Node names. 
+//		Line 1858 :     class FanoutTable defines the CSR Node-to-component adjacency used to propagate events. 
+//		Line 1919 :     class GateTable defines the packed struct-of-arrays gate store evaluated by the simulators. 
+//		Line 2006 :     class GateState defines the gate output values of one Circuit evaluated over a GateTable. 
+//		Line 2043 :     Compressed Waveforms defines the LZ-compressed block waveform files (.dsw) and their reader. 
+//		Line 2530 :     Waveform Database defines the indexed waveform files (.wdb) answering value and toggle queries. 
+//		Line 2779 :     class WaveformRing defines the lock-free ring passing value changes to the waveform writer thread. 
+//		Line 2897 :     struct WaveformOptions defines how a simulation writes its waveform (thread, format, dumped Nodes). 
+//		Line 2930 :     class VCDWriter defines the VCD waveform file writer used by the simulators. 
+//		Line 3342 :     Pattern Kernels defines the scalar/AVX2/AVX-512 gate kernels used by pattern simulation. 
+//		Line 3501 :     Native Code Modules defines the loader and cache for netlists compiled to shared libraries. 
+//		Line 3633 :     class WorkerPool defines the pool of worker threads used by the batch simulations. 
+//		Line 3706 :     class Netlist defines the read-only netlist tables shared by all Circuits made from a netlist. 
+//		Line 4083 :     class Circuit defines the Circuit object for the simulators. Describes top level connections. 
+//		Line 4390 :     Circuit:Function Timing Simulation defines the process of running a timing simulation.
+//		Line 4485 :     Circuit:Function Functional Simulation defines the process of running a functional simulation. 
+//		Line 4605 :     Circuit:Function Levelized Functional Simulation defines the levelized (queue-free) functional simulation. 
+//		Line 4745 :     Circuit:Function Cycle-based Functional Simulation defines the once-per-clock-edge functional simulation. 
+//		Line 4845 :     Circuit:Function Compiled Functional Simulation defines the functional simulation run by a compiled netlist. 
+//		Line 5060 :     Circuit:Function Pattern Simulation defines the 64-way bit-parallel pattern simulation API. 
+//		Line 5176 :     Circuit:Function Reset defines the return of a Circuit to its initial state between batch runs. 
+//		Line 5354 :     class FaultVectorGenerator defines the Fault Vector Generator for generating Fault Vectors. 
+//		Line 5623 :     Batch Simulation defines the multithreaded batch of functional simulations (digisim --batch). 
+//		Line 5677 :     Benchmarks defines the built-in performance benchmarks (digisim --bench <name>). 
+//		Line 6675 :     Regression Tests defines the built-in regression tests (digisim --test). 
+//		Line 7240 :     main()
 //
 // Revision History:
 //		May 09, 2023    Hector Wilson      Initial revision 
@@ -74,6 +99,19 @@
 #include <list>
 #include <time.h>
 #include <filesystem>
+#include <string_view>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <charconv>
+#include <regex>
+#include <limits>
 using namespace std;
 
 
@@ -89,19 +127,28 @@ enum LogicValue { ZERO, ONE, X, U, Z};
 // ----------------------------------------------- Circuit Nodes ----------------------------------------------------
 // ------------------------------------------------------------------------------------------------------------------
 // This class implements Node objects for the circuit and simulator. 
-// The nodes contain 3 attributes. The name is defined from the netlist
+// The nodes contain 4 attributes. The name is defined from the netlist
 // input by the user. CurValue is the current logic value listed on the 
 // Node. The integer StuckAtOp is a control signal indicating if the 
-// Node object is a stuck-at node. 
+// Node object is a stuck-at node. The integer index is the Node's slot in
+// the Circuit symbol table (-1 if the Node was created outside a Circuit). 
+// The last 2 attributes are the Event Queue's handle on the pending updates
+// to this Node (see EventQueue::Delete). 
 class Node {
 public:
 	string name;
 	LogicValue CurValue;
 	int StuckAtOp;
-	Node(string x) {
+	int index;
+	int pendingEvents; // number of queued Events that will update this Node
+	int eventGen;      // queued Events stamped with an older generation have been cancelled
+	Node(string x, int i = -1) {
 		name = x; // set name of node. 
 		CurValue = ZERO; // initialize Node to value 0. 
 		StuckAtOp = 0; // disable stuck-at (i.e. allow changes). 
+		index = i; // symbol table index of node.
+		pendingEvents = 0;
+		eventGen = 0;
 	}
 
 	// This Function reads off the current value of the Node. 
@@ -133,8 +180,8 @@ public:
 // ------------------------------------------------------------------------------------------------------------------
 // This class implements base Component objects for the circuit and simulator. 
 // The components contain the following protected attributes. An arrays of pointers 
-// to input Nodes and the string output Node name. A vector of integer logic values 
-// the circuit inputs. A vector of strings storing the names of all the input Nodes. 
+// to input Nodes and the string output Node name. A vector of strings storing the 
+// names of all the input Nodes. 
 // Additionally, there is the pointer to the output Node and the integer delay 
 // associated with updating this component. 
 class Component {
@@ -150,16 +197,21 @@ public:
 
 };
 
+// ------------------------------------------------------------------------------------------------------------------
+// Logic functions of the combinatorial gates. The inverting gates are their non-inverting function + 3. 
+enum GateOp { AND_OP, OR_OP, XOR_OP, NAND_OP, NOR_OP, XNOR_OP };
+
 // ------------------------------------------------------------------------------------------------------------------
 // This class implements a sub-base class for simple Combinatorial logic gates. These gates only
 // have 2 relevant delays associated with each component, the rise time and the fall time delay. 
 // At the moment, these are the only types of gates able to used in a circuit for this system. 
 // These simple gates contain the following additional protected attributes: Rise and fall time 
 // delays associated with each one of these gates. The current and previous output value. 
+// The simulators evaluate the gates of a Circuit through its GateTable and a Circuit creates no 
+// gate objects; these classes remain the object view of a single gate. 
 class ComboLogicGate: public Component {
 protected:
 	string outputName; // Node name on the output of this component
-	vector<int> inputValues;
 	int rise_Time;
 	int fall_Time;
 	int outputValue = 0;
@@ -170,6 +222,8 @@ public:
 	Node *inputs[8];   // we have up to 8 pointers to the inputs of each circuit component. 
 	Node *output;	   // 1 pointer to the output of each circuit component. 
 	int delay;		   // integer delay associated with updating this component's output logic value. 
+	GateOp op;         // logic function of this component (used by pattern simulation). 
+
 };
 
 // ------------------------------------------------------------------------------------------------------------------
@@ -195,6 +249,8 @@ public:
         this->setupTime = setup;
         this->holdTime = hold;
         lastClockState = false; // Start with clock low
+        outQ = ZERO;  // Q and Qn output nodes start at 0 like every other node
+        outQn = ZERO;
     }
 
     // Calculate function for DFF takes in the time of the clock change for calculating
@@ -221,6 +277,21 @@ public:
         lastClockState = (CLK->CurValue == ONE);
     }
 
+    // State holds everything a DFF changes while simulating, so a Circuit can save and restore it. 
+    struct State {
+        bool lastClockState;
+        LogicValue outQ, outQn;
+        int Dchange_time, CLKchange_time;
+    };
+    State Save() { return {lastClockState, outQ, outQn, Dchange_time, CLKchange_time}; }
+    void Restore(const State& s) {
+        lastClockState = s.lastClockState;
+        outQ = s.outQ;
+        outQn = s.outQn;
+        Dchange_time = s.Dchange_time;
+        CLKchange_time = s.CLKchange_time;
+    }
+
     LogicValue ReadQ() {return outQ;}
     LogicValue ReadQn() {return outQn;}
 
@@ -241,6 +312,7 @@ public:
 	// Constructor for the AND gate assigns all Node pointers and sets the rise and fall time delays. 
 	ANDgate(Node* out, int x, int y, Node* in1, Node* in2, Node* in3, 
 			Node* in4, Node* in5, Node* in6, Node* in7, Node* in8) {
+		op = AND_OP;
 		rise_Time = x;
 		fall_Time = y;
 		inputs[0] = in1; 
@@ -271,7 +343,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue & tempoutputValue;
 			}
 		}
@@ -302,7 +373,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue & tempoutputValue;
 			}
 		}
@@ -342,6 +412,7 @@ public:
 	// Constructor for the OR gate assigns all Node pointers and sets the rise and fall time delays. 
 	ORgate(Node* out, int x, int y, Node* in1, Node* in2, Node* in3, 
 		   Node* in4, Node* in5, Node* in6, Node* in7, Node* in8) {
+		op = OR_OP;
 		rise_Time = x;
 		fall_Time = y;
 		inputs[0] = in1; 
@@ -372,7 +443,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue | tempoutputValue;
 			}
 		}
@@ -403,7 +473,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue | tempoutputValue;
 			}
 		}
@@ -444,6 +513,7 @@ public:
 	// Constructor for the XOR gate assigns all Node pointers and sets the rise and fall time delays. 
 	XORgate(Node* out, int x, int y, Node* in1, Node* in2, Node* in3, 
 			Node* in4, Node* in5, Node* in6, Node* in7, Node* in8) {
+		op = XOR_OP;
 		rise_Time = x;
 		fall_Time = y;
 		inputs[0] = in1; 
@@ -474,7 +544,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue ^ tempoutputValue;
 			}
 		}
@@ -505,7 +574,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue ^ tempoutputValue;
 			}
 		}
@@ -545,6 +613,7 @@ public:
 	// Constructor for the NAND gate assigns all Node pointers and sets the rise and fall time delays. 
 	NANDgate(Node* out, int x, int y, Node* in1, Node* in2, Node* in3, 
 			 Node* in4, Node* in5, Node* in6, Node* in7, Node* in8) {
+		op = NAND_OP;
 		rise_Time = x;
 		fall_Time = y;
 		inputs[0] = in1; 
@@ -575,7 +644,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue & tempoutputValue;
 			}
 		}
@@ -607,7 +675,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue & tempoutputValue;
 			}
 		}
@@ -648,6 +715,7 @@ public:
 	// Constructor for the NOR gate assigns all Node pointers and sets the rise and fall time delays. 
 	NORgate(Node* out, int x, int y, Node* in1, Node* in2, Node* in3, 
 		    Node* in4, Node* in5, Node* in6, Node* in7, Node* in8) {
+		op = NOR_OP;
 		rise_Time = x;
 		fall_Time = y;
 		inputs[0] = in1; 
@@ -678,7 +746,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue | tempoutputValue;
 			}
 		}
@@ -710,7 +777,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue | tempoutputValue;
 			}
 		}
@@ -751,6 +817,7 @@ public:
 	// Constructor for the XNOR gate assigns all Node pointers and sets the rise and fall time delays. 
 	XNORgate(Node* out, int x, int y, Node* in1, Node* in2, Node* in3, 
 			 Node* in4, Node* in5, Node* in6, Node* in7, Node* in8) {
+		op = XNOR_OP;
 		rise_Time = x;
 		fall_Time = y;
 		inputs[0] = in1; 
@@ -781,7 +848,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue ^ tempoutputValue;
 			}
 		}
@@ -813,7 +879,6 @@ public:
 		for (int i=0; i < 8; i++) {
 			if (inputs[i] != NULL) {
 				int nodeValue = ((inputs[i]->ReadValue()) == ZERO) ? 0 : 1;
-				inputValues.push_back(nodeValue);
 				tempoutputValue = nodeValue ^ tempoutputValue;
 			}
 		}
@@ -847,1068 +912,6461 @@ public:
 };
 
 // ------------------------------------------------------------------------------------------------------------------
-// --------------------------------------------- EVENT QUEUE OBJECTS ------------------------------------------------
+// ----------------------------------------------- TEXT FILE PARSING ------------------------------------------------
 // ------------------------------------------------------------------------------------------------------------------
-// This class implements Event objects for the event queue used by the simulators in this system. 
-// Each Event object contains the following attributes: A pointer to a Component and a pointer to a Node. 
-// Depending on the type of event (update Node or update Component), the opposite type pointer will be NULL. 
-// Integer eventTime is the time at which the event should be executed in the circuit. The next value of the Node
-// being updated by this event (only matters for Node events). And lastly, an additional indicator CN = 0 when  
-// the event is a Component update and CN = 1 when the event is a Node update. 
-class Event {
+// The netlist and stimulus readers parse their files in place: the file is mapped into memory (see MappedFile) and 
+// cut into lines and tokens that are string_view slices of the mapping (see TextScanner), so no string is allocated 
+// per token, and numbers are converted with from_chars. A token starting with '#' starts a comment that runs to the 
+// end of the line, so both comment lines and trailing comments like "# Register output of Node6" are skipped. 
+// Mapping needs mmap, so on other platforms the file is read into memory instead. 
+#if defined(__unix__) || defined(__APPLE__)
+#define DIGISIM_MAPPED_FILES 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// This class maps a file read-only into memory for the lifetime of the object. A missing file reads as empty. Pass 
+// sequential = false for files that are read at random rather than front to back. 
+class MappedFile {
+private:
+	const char* data = NULL;
+	size_t size = 0;
+	bool mapped = false;
+	string contents; // the file contents where the file cannot be mapped
+
 public:
-	Component *eventComp;
-	Node *eventNode;
-	int eventTime;
-	LogicValue nextVal;
-	int CompNode; // Comp = 0, Node = 1 
-	Event(Component* x, Node* y, int t, LogicValue z, int CN) {
-		eventTime = t;
-		eventComp = x;
-		eventNode = y;
-		nextVal = z;
-		CompNode = CN;
+	MappedFile(const string& file, bool sequential = true) {
+#ifdef DIGISIM_MAPPED_FILES
+		int fd = open(file.c_str(), O_RDONLY);
+		struct stat info;
+		if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0) {
+			void* p = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				// text is read front to back, so let the kernel read ahead (files queried at random don't)
+				madvise(p, info.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+				data = (const char*)p;
+				size = info.st_size;
+				mapped = true;
+			}
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+		if (mapped) {
+			return;
+		}
+#endif
+		ifstream File(file, ios::binary);
+		stringstream buffer;
+		buffer << File.rdbuf();
+		contents = buffer.str();
+		data = contents.data();
+		size = contents.size();
 	}
-};
-
-// ------------------------------------------------------------------------------------------------------------------
-// This struct implements the comparator for the priority queue data structure used to define Event Queues. The
-// comparator will organize the priority queue based on the value of the eventTime attribute in each Event object. 
-struct LessThanTime
-{
-  bool operator()(const Event& lhs, const Event& rhs) const
-  {
-    return lhs.eventTime > rhs.eventTime;
-  }
-};
 
-// ------------------------------------------------------------------------------------------------------------------
-// This class implements the Event Queue for the system simulators. 
-// The Event Queue is implemented as a priority queue with a custom comparator defined above LessThanTime. 
-// The Event Queue has a total of 4 associated functions defined below. 
-class EventQueue {
-public:
-	priority_queue<Event, vector<Event>, LessThanTime> PQ;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
 
-	// This function adds a passed Event to the Event Queue. 
-	void Append(Event x) {
-		PQ.push(x);
+	~MappedFile() {
+#ifdef DIGISIM_MAPPED_FILES
+		if (mapped) {
+			munmap((void*)data, size);
+		}
+#endif
 	}
 
-	// This function removes the top Event from the Event Queue. 
-	void Pop() {
-		PQ.pop();
+	// This function returns the contents of the file. 
+	string_view Text() const { return string_view(data, size); }
+};
+
+// This class cuts a text into lines, and the current line into whitespace separated tokens (like getline and 
+// stringstream >> do), as string_view slices of the text. 
+class TextScanner {
+private:
+	string_view text;
+	size_t pos = 0;   // start of the next line
+	string_view line; // the rest of the current line
+
+	static bool IsSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
 	}
 
-	// This function deletes all Events in the queue pertaining to an input Node 
-	// It is used when the simulator has to cancel a Node update before the delay has completed. 
-	void Delete(Node* x, Component* y) {
-		priority_queue<Event, vector<Event>, LessThanTime> tempPQ; // temporary Queue to be modified
-		priority_queue<Event, vector<Event>, LessThanTime> newPQ; // new Event Queue being made clean
-		tempPQ = PQ;
-
-		// Only add Events to the new Event Queue if they dont have the given rotten input Node. 
-		while (!tempPQ.empty()) {
-			// if next Event doesnt contain passed input Node, then add it to the new Event Queue
-			if (tempPQ.top().eventNode != x) {
-				newPQ.push(tempPQ.top());
-			}
-			// if the next Event does contain passed input Node, then dont add it to the new Event Queue
-			// and additionally revert the output of the passed component.
-			else {
-				// Revert the output of the gate if the queue contained a rotten node update
-				y->RevertOutput();
-			}
+public:
+	TextScanner(string_view t) : text(t) {}
 
-			tempPQ.pop();
+	// This function moves on to the next line. Returns false at the end of the text. 
+	bool NextLine() {
+		if (pos >= text.size()) {
+			return false;
 		}
-
-		// Store the clean Event Queue back into PQ. 
-		PQ = newPQ;
+		size_t end = text.find('\n', pos);
+		end = (end == string_view::npos) ? text.size() : end;
+		line = text.substr(pos, end - pos);
+		pos = end + 1;
+		return true;
 	}
 
-	// This function returns the next Event to be executed in the Event Queue. 
-	Event Top() {
-		return PQ.top();
+	// This function returns the next token of the current line, or an empty token at the end of the line or at a 
+	// comment. 
+	string_view Token() {
+		size_t i = 0;
+		while (i < line.size() && IsSpace(line[i])) {
+			i++;
+		}
+		size_t j = i;
+		while (j < line.size() && !IsSpace(line[j])) {
+			j++;
+		}
+		string_view token = line.substr(i, j - i);
+		line = line.substr(j);
+		if (!token.empty() && token[0] == '#') {
+			line = string_view();
+			return string_view();
+		}
+		return token;
 	}
+
+	// These functions return and set the offset of the next line, to come back to a line later. 
+	size_t Position() const { return pos; }
+	void Seek(size_t offset) { pos = offset; }
 };
 
+// This function parses the leading number of a token (like stringstream >> does) into value. Returns false, 
+// leaving value unchanged, if the token does not start with a number. 
+template <typename T> bool ParseNumber(string_view token, T& value) {
+	return from_chars(token.data(), token.data() + token.size(), value).ec == errc();
+}
+
 // ------------------------------------------------------------------------------------------------------------------
-// --------------------------------------------------- CIRCUIT ------------------------------------------------------
+// ------------------------------------------------ NETLIST IMAGES --------------------------------------------------
 // ------------------------------------------------------------------------------------------------------------------
-// This very important class (VIC) implements the circuit object used by both simulator types as well as the fault 
-// vector generator. A circuit objects is responsible for establishing all top level connections between Nodes, 
-// Components, as well as inputs/outputs to the circuit. These top level connections are defined by the netlist 
-// fed into the program at the start. A Circuit object also contains the functions which define the operation 
-// of the system. That is, we define below functions for running Timing Simulations, Functional Simulations, and
-// Fault Vector Generation on a Circuit object. 
-class Circuit {
+// Reading a netlist (tokenizing it, interning its Node names, finding its inputs and outputs, building its fanout 
+// tables and levelizing it) is repeated by every run of the program on it. So the first read of a netlist saves 
+// everything it derived into a binary netlist image next to the netlist file (netlist.txt -> netlist.txt.dsimg), 
+// and later reads map the image and copy its arrays in place instead (see Netlist::LoadImage). An image is a header 
+// followed by arrays, each an 8-byte element count and the elements padded to 8 bytes. The header holds the image 
+// version and the hash and size of the netlist text the image was made from, so an image is only used while it 
+// matches both the netlist file and this version of DigiSim.
+
+// Version of the image layout. Bump it whenever Netlist::SaveImage changes so stale images are not used. 
+const uint32_t NETLIST_IMAGE_VERSION = 1;
+const char NETLIST_IMAGE_MAGIC[8] = {'D', 'S', 'N', 'E', 'T', 'I', 'M', 'G'};
+
+// This Function returns the 64-bit FNV-1a hash of the passed bytes. 
+uint64_t FNV1a64(string_view data) {
+	uint64_t h = 14695981039346656037ULL;
+	for (char c : data) {
+		h = (h ^ (unsigned char)c) * 1099511628211ULL;
+	}
+	return h;
+}
+
+// This class writes a netlist image. The image is written under a temporary name and renamed by Close, so a 
+// concurrent run never maps a half written image. 
+class ImageWriter {
 private:
-	// Circuit objects contain the following private attributes:
-	string netlist;                // user-input netlist detailing top-level circuit connections
-	ComboLogicGate **comps = NULL; // array of pointers to combinatorial Component objects
-	DFF **dffs = NULL;             // array of pointers to sequential DFF objects
-	set<Node*> nodes;			   // set of pointers to all Node objects
-	set<Node*> outputnodes;        // set of pointers to output Node objects
-	set<Node*> inputnodes;		   // set of pointers to input Node objects
-	set<string> nodeNames;         // set of strings of all Node names
-	EventQueue queue;              // the Event Queue for the Circuit
-  
-	int compCnt=0;				   // the number of combo Components in the Circuit
-	int dffCnt=0;                  // the number of DFFs in the Circuit
-	int nodeCnt=0;				   // the number of Nodes in the Circuit
-public:
-	// The constructor for the Circuit object is passed a string netlist file. The constructor opens the file
-	// and creates the Circuit passed on the netlist. 
-	Circuit(string z) {
-		netlist = z;
+	string file;
+	string temp;
+	ofstream out;
+	uint64_t written = 0;
+
+	void Bytes(const void* data, size_t size) {
+		out.write((const char*)data, size);
+		written += size;
+	}
 
-		list<string> ComboLogicOptions = {".OR", ".AND", ".XOR", ".NOR", ".NAND", ".XNOR"};
+public:
+	// The image of a netlist with the passed text hash and size is written to file (or another kind of image, 
+	// with its own magic and version). 
+	ImageWriter(const string& imageFile, uint64_t hash, uint64_t size, const char* magic = NETLIST_IMAGE_MAGIC, 
+	            uint32_t imageVersion = NETLIST_IMAGE_VERSION) {
+		file = imageFile;
+		temp = imageFile + "." + to_string(std::hash<thread::id>()(this_thread::get_id()));
+#ifdef DIGISIM_MAPPED_FILES
+		temp += "." + to_string(getpid());
+#endif
+		out.open(temp, ios::binary);
+		uint32_t version[2] = {imageVersion, 0};
+		Bytes(magic, sizeof(NETLIST_IMAGE_MAGIC));
+		Bytes(version, sizeof(version));
+		Bytes(&hash, sizeof(hash));
+		Bytes(&size, sizeof(size));
+	}
 
-		// BEGIN READING NETLIST FILE
-		string line;
-		ifstream MyReadFile(z);
-		while (getline (MyReadFile,line)) {
-			// The input netlist has the following format to be read:
-			// OUTPUT   .COMPONENT    (DELAYS)    INPUT1     INPUT2    ....
-			stringstream linestream(line);
+	// This function writes an array of count elements. 
+	template <typename T> void Array(const T* items, size_t count) {
+		uint64_t n = count;
+		Bytes(&n, sizeof(n));
+		Bytes(items, count*sizeof(T));
+		const char padding[8] = {0};
+		Bytes(padding, (8 - written % 8) % 8);
+	}
+	template <typename T> void Array(const vector<T>& items) {
+		Array(items.data(), items.size());
+	}
 
-			string out;      // 1 output
-			string compType; // component type
-			string ins[8];   // up to 8 inputs
-			int delay[2];   // up to 2 delay parameters 
-			linestream >> out >> compType;
+	// This function finishes the image. Returns false (leaving no image behind) if it could not be written. 
+	bool Close() {
+		out.close();
+		error_code ec;
+		if (out.fail()) {
+			filesystem::remove(temp, ec);
+			return false;
+		}
+		filesystem::rename(temp, file, ec);
+		if (ec) {
+			filesystem::remove(temp, ec);
+			return false;
+		}
+		return true;
+	}
+};
 
-			// ------------------------------
-			// skip comment lines
-			if (out == "#") {continue;} 
+// This class reads the arrays of a mapped netlist image in the order they were written. Arrays are returned as 
+// pointers into the image, so reading them allocates nothing; Ok() turns false if the image ends early. 
+class ImageReader {
+private:
+	string_view image;
+	size_t pos = 0;
+	bool ok = true;
 
-			// ------------------------------
-			// process combinatorial logic unit
-			if (find(ComboLogicOptions.begin(), ComboLogicOptions.end(), compType) != ComboLogicOptions.end()) {
-				// Allocate +1 space in Component array
-				ComboLogicGate **tempcomps = new ComboLogicGate*[compCnt+1];
-				// Add all previous Components in old array to new array
-				for (int j=0; j<compCnt; ++j) {
-					tempcomps[j] = comps[j];
-				}
+public:
+	ImageReader(string_view data) : image(data) {}
+
+	// This function reads the header and returns true if it is a current image of a netlist with the passed text 
+	// hash and size (or of another kind of image, with its own magic and version). 
+	bool Header(uint64_t hash, uint64_t size, const char* magic = NETLIST_IMAGE_MAGIC, 
+	            uint32_t imageVersion = NETLIST_IMAGE_VERSION) {
+		const size_t headerSize = sizeof(NETLIST_IMAGE_MAGIC) + 2*sizeof(uint32_t) + 2*sizeof(uint64_t);
+		if (image.size() < headerSize || memcmp(image.data(), magic, sizeof(NETLIST_IMAGE_MAGIC)) != 0) {
+			return false;
+		}
+		uint32_t version[2];
+		uint64_t imageHash, imageSize;
+		memcpy(version, image.data() + 8, sizeof(version));
+		memcpy(&imageHash, image.data() + 16, sizeof(imageHash));
+		memcpy(&imageSize, image.data() + 24, sizeof(imageSize));
+		pos = headerSize;
+		return version[0] == imageVersion && imageHash == hash && imageSize == size;
+	}
 
+	// This function returns the next array and its element count, or NULL and 0 if the image ends early. 
+	template <typename T> const T* Array(size_t& count) {
+		uint64_t n = 0;
+		if (ok && pos + sizeof(n) <= image.size()) {
+			memcpy(&n, image.data() + pos, sizeof(n));
+		}
+		if (!ok || pos + sizeof(n) > image.size() || n > (image.size() - pos - sizeof(n)) / sizeof(T)) {
+			ok = false;
+			count = 0;
+			return NULL;
+		}
+		const T* items = (const T*)(image.data() + pos + sizeof(n));
+		pos += sizeof(n) + n*sizeof(T);
+		pos += (8 - pos % 8) % 8;
+		count = n;
+		return items;
+	}
 
-				Node **inputPtr = NULL;		// array of input pointers used to create Components
-				inputPtr = new Node*[8];    // array should have length 8 (8 is max # of inputs for a Component)
+	// This function copies the next array into items. 
+	template <typename T> void Array(vector<T>& items) {
+		size_t count;
+		const T* p = Array<T>(count);
+		items.assign(p, p + count);
+	}
 
+	bool Ok() const { return ok; }
+};
 
-				// Find or create output node for logic gate
-				Node *o = FindOrCreateNode(out, nodes, nodeNames);
+// ------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------- STIMULUS SOURCES --------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This class implements the periodic clock generator primitive. A clock source drives a Node with a clock declared 
+// in the netlist as 
+//     CLK   .CLOCK   period   duty   phase   start   stop
+// The Node rises at start + phase, then once every period, and falls duty percent of a period after each rise. No 
+// edge is generated at or after time stop. The simulators do not queue the edges up front: a clock's next edge is 
+// only generated when its current edge executes (see EdgeAfter), so a clock has one pending edge at a time however 
+// long the simulation runs. At equal times the clock edges come after the stimulus changes. 
+class ClockSource {
+public:
+	Node* node;  // the Node driven by the clock
+	int period;
+	int high;    // time the clock is high in each period
+	int first;   // time of the first rising edge
+	int stop;    // no edges at or after this time
+
+	ClockSource(Node* n, int periodTime, int duty, int phase, int start, int stopTime) {
+		node = n;
+		period = max(2, periodTime);
+		high = min(period - 1, max(1, (int)((long long)period * duty / 100)));
+		first = start + phase;
+		stop = stopTime;
+	}
 
-				// read in rise and fall time for combo logic gate
-				linestream >> delay[0] >> delay[1];
-				// read in input(s) for combo logic gate
-				linestream >> ins[0] >> ins[1] >> ins[2] >> ins[3] >> ins[4] >> ins[5] >> ins[6] >> ins[7];
+	// This function returns the time of edge i (rising for even i, falling for odd i), or -1 if the clock stops 
+	// before it. 
+	int EdgeTime(long long i) const {
+		long long time = first + (i / 2) * period + ((i % 2 == 1) ? high : 0);
+		return (time < stop) ? (int)time : -1;
+	}
 
-				// Find or create input node(s) for logic gate
-				for (int i=0; i < 8; i++) {
-					if (!ins[i].empty()) {
-						inputPtr[i] = FindOrCreateNode(ins[i], nodes, nodeNames);
-					}
-					// If the Component doesn't user up all 8 inputs then set those input pointers to NULL
-					else{
-						inputPtr[i] = NULL;
-					}
-				}
+	// This function returns the value the Node takes at edge i. 
+	LogicValue EdgeValue(long long i) const {
+		return (i % 2 == 0) ? ONE : ZERO;
+	}
 
-				// Determine the type of Component being made and create the Component with proper Node pointers and delay values. 
-				if (compType.compare(".OR") == 0) {
-					ORgate *q = new ORgate(o, delay[0], delay[1], inputPtr[0], inputPtr[1], inputPtr[2], 
-					                       inputPtr[3], inputPtr[4], inputPtr[5], inputPtr[6], inputPtr[7]);
-					tempcomps[compCnt] = q;
-				}
-				else if (compType.compare(".AND") == 0) {
-					ANDgate *q = new ANDgate(o, delay[0], delay[1], inputPtr[0], inputPtr[1], inputPtr[2], 
-						                     inputPtr[3], inputPtr[4], inputPtr[5], inputPtr[6], inputPtr[7]);
-					tempcomps[compCnt] = q;
-				}
-				else if (compType.compare(".XOR") == 0) {
-					XORgate *q = new XORgate(o, delay[0], delay[1], inputPtr[0], inputPtr[1], inputPtr[2], 
-						                     inputPtr[3], inputPtr[4], inputPtr[5], inputPtr[6], inputPtr[7]);
-					tempcomps[compCnt] = q;
-				}
-				else if (compType.compare(".NOR") == 0) {
-					NORgate *q = new NORgate(o, delay[0], delay[1], inputPtr[0], inputPtr[1], inputPtr[2], 
-						                     inputPtr[3], inputPtr[4], inputPtr[5], inputPtr[6], inputPtr[7]);
-					tempcomps[compCnt] = q;
-				}
-				else if (compType.compare(".NAND") == 0) {
-					NANDgate *q = new NANDgate(o, delay[0], delay[1], inputPtr[0], inputPtr[1], inputPtr[2], 
-						                       inputPtr[3], inputPtr[4], inputPtr[5], inputPtr[6], inputPtr[7]);
-					tempcomps[compCnt] = q;
-				}
-				else if (compType.compare(".XNOR") == 0) {
-					XNORgate *q = new XNORgate(o, delay[0], delay[1], inputPtr[0], inputPtr[1], inputPtr[2], 
-						                       inputPtr[3], inputPtr[4], inputPtr[5], inputPtr[6], inputPtr[7]);
-					tempcomps[compCnt] = q;
-				}
+	// This function returns the index of the first edge after the passed time. 
+	long long EdgeAfter(int time) const {
+		if (time < first) {
+			return 0;
+		}
+		long long k = (time - first) / period;
+		return 2*k + (((time - first) % period < high) ? 1 : 2);
+	}
+};
 
-				// Increase the Component count by 1 after reading each line of a netlist. 
-				++compCnt;
-				// Delete old Component array
-				delete[] comps;
-				// And set it to new Component array
-				comps = tempcomps;
+// ------------------------------------------------------------------------------------------------------------------
+// This class reads a stimulus file as a stream of (time, Node, value) input changes in time order. Changes at the 
+// same time keep their order in the file, and lines naming an unknown Node are skipped. Node names are resolved 
+// through the passed lookup (see Circuit::FindNode). 
+//
+// The file is mapped (see MappedFile) and scanned once when the stream is opened, to count the changes and check 
+// they are in time order. A file in time order is then parsed one line at a time as the simulators pull the 
+// changes, so only the current change is held however long the stimulus is. The changes of a file out of time 
+// order are all read and sorted. 
+class StimulusStream {
+private:
+	MappedFile file;
+	TextScanner scanner;
+	function<Node*(string_view)> find;
+	vector<tuple<int, Node*, LogicValue>> sorted; // the whole stimulus, when the file is out of time order
+	bool ordered = true;
+	long long count = 0;              // number of changes
+	long long index = 0;              // index of the current change
+	int time = -1;                    // the current change, time -1 once the stream is exhausted
+	Node* node = NULL;
+	LogicValue value = Z;
+	vector<int> slot;                 // Node index -> slot in the Node lists below, or -1
+	vector<Node*> targets;            // the Nodes changed by the stimulus
+	vector<int> changeCnt;            // number of changes of each Node
+	vector<int> gen;                  // cancellation generation of each Node when its changes were expected
+
+	// This function reads lines until one holds a change of a known Node. Returns false at the end of the file. 
+	bool ReadChange(int& t, Node*& n, LogicValue& v) {
+		while (scanner.NextLine()) {
+			double lineTime = 0;
+			if (!ParseNumber(scanner.Token(), lineTime)) {
+				continue;
 			}
-			// ------------------------------
-			// process sequential logic DFF unit
-			else if (compType.compare(".DFF") == 0) {
-				// Allocate +1 space in DFF array
-				DFF **tempdffs = new DFF*[dffCnt+1];
-				// Add all previous DFFs in old array to new array
-				for (int j=0; j<dffCnt; ++j) {
-					tempdffs[j] = dffs[j];
-				}
-
-				float setupTime, holdTime;
-				string D, Q, Qn, CLK;
-				linestream >> setupTime >> holdTime >> D >> CLK >> Q >> Qn;
-				// Create or reuse nodes for this DFF
-				// Use the helper function to retrieve or create nodes
-			    Node* dNode = FindOrCreateNode(D, nodes, nodeNames);
-			    Node* clkNode = FindOrCreateNode(CLK, nodes, nodeNames);
-			    Node* qNode = FindOrCreateNode(Q, nodes, nodeNames);
-			    Node* qnNode = FindOrCreateNode(Qn, nodes, nodeNames);
-
-			    // Create and store the new DFF component
-			    DFF* dff = new DFF(dNode, clkNode, qNode, qnNode, setupTime, holdTime);
-			    tempdffs[dffCnt] = dff;
-
-			    // Increase the Component count by 1 after reading each line of a netlist. 
-				++dffCnt;
-				// Delete old Component array
-				delete[] dffs;
-				// And set it to new Component array
-				dffs = tempdffs;	
-
+			n = find(scanner.Token());
+			if (n != NULL) {
+				string_view newVals = scanner.Token();
+				t = (int)lineTime;
+				v = (newVals == "0") ? ZERO : (newVals == "1") ? ONE : Z;
+				return true;
 			}
 		}
-		// Call the FindIOs function to determine which nodes are inputs/outputs to the netlist. 
-		FindIOs();
-
-		// Close File. 
-		MyReadFile.close();
-		cout << "Circuit Netlist Mapped" << endl;
+		return false;
 	}
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// Helper function to search through existing nodes
-	// If a node already exists with the nodeName, return that node
-	// Otherwise, create a new node with that nodeName
-	Node* FindOrCreateNode(const string& nodeName, set<Node*>& nodes, set<string>& nodeNames) {
-	    // Check if the node already exists
-	    for (Node* node : nodes) {
-	        if (node->name == nodeName) {
-	            return node; // Return existing node
-	        }
-	    }
-	    
-	    // If not found, create a new one
-	    Node* newNode = new Node(nodeName);
-	    nodes.insert(newNode);
-	    nodeNames.insert(nodeName);
-	    return newNode;
+	// This function makes the next change of the stream current. 
+	void Load() {
+		if (ordered) {
+			if (!ReadChange(time, node, value)) {
+				time = -1;
+			}
+		}
+		else if (index < count) {
+			tie(time, node, value) = sorted[index];
+		}
+		else {
+			time = -1;
+		}
 	}
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// This Function runs to determine which nodes in the circuit are inputs and outputs (IOs). It adds these nodes
-	// to seperate sets containing input node pointers and output node pointers. 
-	void FindIOs() {
-		// Determine which Nodes are inputs/outputs to the netlist and add them to the list of input/output node pointers. 
-		// start by looping through each node. 
-		for (set<string>::iterator i = nodeNames.begin(); i != nodeNames.end(); i++) {
-			int input_occurances = 0;
-			int output_occurances = 0;
-			// loop through each component and see if the node is an output or input to the component. 
-			for (int j=0; j<compCnt; j++) {
-				// Check if Node is an output to this component. 
-				string compOutputName = comps[j]->ReadOutputName();
-				if ((*i) == compOutputName) {
-					output_occurances += 1;
-				}
-				// Check if Node is an input to this component. 
-				vector<string> compInputNames = comps[j]->ReadInputNames();
-				for (vector<string>::iterator k = compInputNames.begin(); k != compInputNames.end(); k++) {
-					if ((*k) == (*i)) {
-						input_occurances += 1; 
-					}
-				}
+public:
+	StimulusStream(string z, function<Node*(string_view)> findNode) : file(z), scanner(file.Text()), find(findNode) {
+		int t, last = INT32_MIN;
+		Node* n;
+		LogicValue v;
+		while (ReadChange(t, n, v)) {
+			ordered = ordered && t >= last;
+			last = t;
+			count++;
+			if (n->index >= (int)slot.size()) {
+				slot.resize(n->index + 1, -1);
 			}
-			// If the Node never appeared as an output to a component then it is an input. 
-			if (output_occurances == 0) {
-				for (set<Node*>::iterator k = nodes.begin(); k != nodes.end(); k++) {
-					if ((*k)->name == (*i)) {
-						inputnodes.insert(*k);
-					}
-				}
+			if (slot[n->index] < 0) {
+				slot[n->index] = targets.size();
+				targets.push_back(n);
+				changeCnt.push_back(0);
+				gen.push_back(0);
 			}
-			// If the Node never appeared as an input to a component then it is an output. 
-			if (input_occurances == 0) {
-				for (set<Node*>::iterator k = nodes.begin(); k != nodes.end(); k++) {
-					if ((*k)->name == (*i)) {
-						outputnodes.insert(*k);
-					}
-				}
+			changeCnt[slot[n->index]]++;
+		}
+		scanner.Seek(0);
+		if (!ordered) {
+			while (ReadChange(t, n, v)) {
+				sorted.push_back(make_tuple(t, n, v));
 			}
+			stable_sort(sorted.begin(), sorted.end(), 
+			            [](const tuple<int, Node*, LogicValue>& x, const tuple<int, Node*, LogicValue>& y) {
+			            	return get<0>(x) < get<0>(y);
+			            });
 		}
+		Load();
 	}
 
-	// --------------------------------------------- TIMING SIMULATION --------------------------------------------------
-	// This Function runs a Timing Simulation on the Circuit. It takes in as an argument the input file as a string.
-	// The Timing Simulator uses an Event Queuing system to determine the order of Events to execute wherein Events 
-	// are queued by realistic execution times based on their associated delays.  
-	void TimingSimulation(string z) {
-		cout << "Starting Timing Simulation..." << endl;
-
-		string line;
-		int inputTime = 0;
-		ifstream InputFile(z);
-		ofstream VCDFile("TimingSimOutput.vcd");
-		VCDFile << "$date " << __DATE__ << " $end\n";
-	    VCDFile << "$version DigiSim Timing Simulator $end\n";
-	    VCDFile << "$timescale 1ns $end\n";
-	    VCDFile << "$scope module circuit $end\n";
-
-		// Assign unique VCD identifiers
-	    int signalIndex = 1;
-	    unordered_map<string, string> signalMap;
-	    for (set<Node*>::iterator i = nodes.begin(); i != nodes.end(); i++) {
-	        string vcdID = "s" + to_string(signalIndex++);
-	        signalMap[(*i)->name] = vcdID;
-	        VCDFile << "$var wire 1 " << vcdID << " " << (*i)->name << " $end\n";
-	    }
-	    VCDFile << "$upscope $end\n";
-	    VCDFile << "$enddefinitions $end\n";
+	// This function returns the number of changes in the stimulus. 
+	long long Size() const { return count; }
 
-	    // output initial node values at time 0 (shoud all be 0). 
-	    VCDFile << "$dumpvars\n";
-	    for (auto& nodePair : signalMap) {
-	        VCDFile << "0" << nodePair.second << "\n";  // Set all signals to 0 initially
-	    }
-	    VCDFile << "$end\n";
+	// This function returns true once every change has been pulled. 
+	bool Empty() const { return time < 0; }
 
+	// These functions return the current change and its index in time order. 
+	int Time() const { return time; }
+	Node* CurNode() const { return node; }
+	LogicValue Value() const { return value; }
+	long long Index() const { return index; }
 
-		// first see if any components are expected to change output logic value based on initial state.
-		// if so.. add to queue. 
-		// if we have any NAND, NOR, XNOR gates start by sending these to the event queue at time 0
-		for (int i=0; i < compCnt; i++) {
-		    // calculate all gate outputs at time 0
-			comps[i]->Calculate();
-			int delay = comps[i]->delay;
+	// This function moves on to the next change. 
+	void Pop() {
+		index++;
+		Load();
+	}
 
-			// if output of a gate will change (delay != 0) at time 0, add it to queue
-			if (delay != 0) {
-				queue.Append(Event(NULL, comps[i]->output, delay, comps[i]->ReadOutput(), 1));
-			}
+	// This function counts every change as pending on its Node from now on, as if they were all queued now, so 
+	// a cancellation of the Node (see EventQueue::Delete) also cancels the changes not pulled yet. 
+	void Expect() {
+		for (size_t k = 0; k < targets.size(); k++) {
+			targets[k]->pendingEvents += changeCnt[k];
+			gen[k] = targets[k]->eventGen;
 		}
+	}
 
-		// also want to update inverse output value of DFFs at time 0 to be 1..
-		// no need to update Q output since it will remain 0. (no clock edge at time 0 possible)
-		// for (int i=0; i < dffCnt; i++) {
-		// 	dffs[i]->Calculate();
-		// 	queue.Append(Event(NULL, dffs[i]->Qn, 0, dffs[i]->ReadQn(), 1));
-		// }
+	// This function returns false if the current change was cancelled since Expect() was called. 
+	bool Alive() const { return gen[slot[node->index]] == node->eventGen; }
+};
 
-		// Add user defined inputs into the event queue
-		while (getline (InputFile,line)) {
-			stringstream linestream(line);
-			string input;
-			string newVals;
-			LogicValue newVal;
-			float time; 
-			linestream >> time >> input >> newVals;
-			if (newVals == "0") { 
-				newVal = ZERO;
-			}
-			else if (newVals == "1") { 
-				newVal = ONE;
+// ------------------------------------------------------------------------------------------------------------------
+// This class merges a stimulus stream with the edges of the clock sources, for the simulators that apply the input 
+// changes one time step at a time. At each time the stimulus changes come first, then the clock edges in netlist 
+// order. 
+class StimulusCursor {
+private:
+	StimulusStream stimulus;
+	const vector<ClockSource>& clocks;
+	vector<long long> edge;            // next edge of each clock
+
+public:
+	StimulusCursor(string z, function<Node*(string_view)> findNode, const vector<ClockSource>& sources) 
+		: stimulus(z, findNode), clocks(sources), edge(sources.size(), 0) {}
+
+	// This function returns the time of the next input change, or -1 if there is none left. 
+	int Time() const {
+		int time = stimulus.Time();
+		for (size_t k = 0; k < clocks.size(); k++) {
+			int edgeTime = clocks[k].EdgeTime(edge[k]);
+			if (edgeTime >= 0 && (time < 0 || edgeTime < time)) {
+				time = edgeTime;
 			}
-			else {
-				newVal = Z;
+		}
+		return time;
+	}
+
+	// This function returns the next input change at the passed time in node and value, or false if there is none. 
+	bool Next(int time, Node*& node, LogicValue& value) {
+		if (!stimulus.Empty() && stimulus.Time() == time) {
+			node = stimulus.CurNode();
+			value = stimulus.Value();
+			stimulus.Pop();
+			return true;
+		}
+		for (size_t k = 0; k < clocks.size(); k++) {
+			if (clocks[k].EdgeTime(edge[k]) == time) {
+				node = clocks[k].node;
+				value = clocks[k].EdgeValue(edge[k]);
+				edge[k]++;
+				return true;
 			}
+		}
+		return false;
+	}
+};
 
-			// Add changes in input nodes to the event queue
-			inputTime = time; 
-			for (set<Node*>::iterator i = nodes.begin(); i != nodes.end(); i++) {
-				if ((*i)->name == input) {
-					queue.Append(Event(NULL, (*i), inputTime, newVal, 1));
-				}
-			}		
+// This Function returns the dump control lines of an input file, "time $dumpon" and "time $dumpoff", as (time, 
+// true for $dumpon) in file order. The simulators skip these lines as changes of unknown Nodes; the waveform 
+// writers use them to turn dumping on and off (see VCDWriter). Only lines holding a '$' are tokenized, so files 
+// without dump control lines are passed over at memchr speed. 
+vector<pair<long long, bool>> ReadDumpMarks(const string& file) {
+	MappedFile InputFile(file);
+	string_view text = InputFile.Text();
+	vector<pair<long long, bool>> marks;
+	for (size_t pos = text.find('$'); pos != string_view::npos; pos = text.find('$', pos)) {
+		size_t start = text.rfind('\n', pos);
+		start = (start == string_view::npos) ? 0 : start + 1;
+		size_t end = text.find('\n', pos);
+		end = (end == string_view::npos) ? text.size() : end;
+		TextScanner line(text.substr(start, end - start));
+		double time;
+		if (line.NextLine() && ParseNumber(line.Token(), time)) {
+			string_view keyword = line.Token();
+			if (keyword == "$dumpon" || keyword == "$dumpoff") {
+				marks.push_back(make_pair((long long)time, keyword == "$dumpon"));
+			}
 		}
+		pos = end;
+	}
+	return marks;
+}
 
+// ------------------------------------------------------------------------------------------------------------------
+// --------------------------------------------- EVENT QUEUE OBJECTS ------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This class implements Event objects for the event queue used by the simulators in this system. 
+// Each Event object contains the following attributes: The index of a Component (gate or DFF) and a pointer to a 
+// Node. Depending on the type of event (update Node or update Component), the Node pointer will be NULL or the index 
+// will be -1. Integer eventTime is the time at which the event should be executed in the circuit. The next value of 
+// the Node being updated by this event (only matters for Node events). And lastly, an indicator CN (EventType) = 0 
+// when the event is a gate update, CN = 1 when the event is a Node update and CN = 2 when the event is a DFF 
+// update, so the simulators can dispatch on it without a dynamic_cast. The sequence number seq is set by 
+// the Event Queue when the Event is appended and orders Events scheduled for the same time (first in, first out). 
+// For Node updates, gen is the Node's cancellation generation when the Event was appended. 
+enum EventType { GATE_EVENT = 0, NODE_EVENT = 1, DFF_EVENT = 2 };
 
-		// start executing event queue for this circuit
-		while (!(queue.PQ).empty()) {
-			Event nextEvent = queue.Top();
+class Event {
+public:
+	Node *eventNode;
+	int eventComp;   // index of the gate (GATE_EVENT) or DFF (DFF_EVENT) to calculate; for Node Events, the clock 
+	                 // source generating the Event (see ClockSource), or -1
+	int eventTime;
+	LogicValue nextVal;
+	int CompNode; // EventType: gate = 0, Node = 1, DFF = 2 
+	int gen = 0;
+	long long seq = 0;
+	Event(int x, Node* y, int t, LogicValue z, int CN) {
+		eventTime = t;
+		eventComp = x;
+		eventNode = y;
+		nextVal = z;
+		CompNode = CN;
+	}
+};
 
-			// if next in Event Queue is a Node then we update the node value and write the change to the output file. 
-			if (nextEvent.CompNode == 1) {
-				nextEvent.eventNode->UpdateValue(nextEvent.nextVal);
-			
+// ------------------------------------------------------------------------------------------------------------------
+// This struct implements the comparator for the priority queue data structure used to define Event Queues. The
+// comparator will organize the priority queue based on the value of the eventTime attribute in each Event object. 
+// Events with the same eventTime are ordered by their sequence number, so they execute in the order they were added. 
+struct LessThanTime
+{
+  bool operator()(const Event& lhs, const Event& rhs) const
+  {
+    if (lhs.eventTime != rhs.eventTime) {
+      return lhs.eventTime > rhs.eventTime;
+    }
+    return lhs.seq > rhs.seq;
+  }
+};
 
-				// *****  Write to the output file the change. ***** 
-        		// Write to VCD file
-		        string vcdID = signalMap[nextEvent.eventNode->name];
-		        VCDFile << "#" << nextEvent.eventTime << "\n";
-		        VCDFile << (nextEvent.nextVal == ONE ? "1" : "0") << vcdID << "\n";
-
-
-        		// Additionally, if any gates use this Node as an input then we must add them to the Event Queue. 
-        		for (int k=0; k < compCnt; k++) {
-					vector<string>  names = (comps[k]->ReadInputNames());
-					for (vector<string>::iterator s = names.begin(); s != names.end(); s++) {
-						if ((*s) == nextEvent.eventNode->name) {
-							// Add all components connected to the changing Node to the Event queue
-							//
-							// We check if this input node change is expected to change the output of any gate its connected to. 
-							// If it will, then we cancel the all pending gate changes already in queue, revert the gate, and add the gate
-							// change to the event queue. 
-							//
-							// If the input node change will not change the output of an already pending gate change event then it overrides 
-							// this event and we do nothing.  
-							if (comps[k]->PreCalc() == 1) {
-								queue.Delete(comps[k]->output, comps[k]);
-								queue.Append(Event(comps[k], NULL, nextEvent.eventTime, Z, 0));
-							}
-							break;
-						}
-					}
-				}
-				// Now, if any DFFs use this Node as a clock then we must add the DFF to Event Queue to update
-				// its output values Q, Qn.
-				//
-				// Additionally, if this Node is a D input to a DFF, we must start timers to check for setup
-				// and hold time violations.
-				for (int k=0; k < dffCnt; k++) {
-					if (dffs[k]->CLK->name == nextEvent.eventNode->name) {
-						queue.Append(Event(dffs[k], NULL, nextEvent.eventTime, Z, 0));
-					}
-					// to set timers for calculating setup/hold time violations..
-					if (dffs[k]->D->name == nextEvent.eventNode->name) {
-						dffs[k]->ErrTimersD(nextEvent.eventTime, 1); // call function to check for hold time violation
-					}
-				}
-			}
-			// if next in Event Queue is a Component then calculate Component and compute delay
-			else if (nextEvent.CompNode == 0) {
-				// Only apply delay for combinational gates for now..
-				// 
-				// when a gate changes output state, add the output wire node to queue to update
-				// after delay completes
-			    if (ComboLogicGate* gate = dynamic_cast<ComboLogicGate*>(nextEvent.eventComp)) {
-			    	gate->Calculate(); // Calculate gate change
-			        int delay = gate->delay;  // if delay is none zero, output of gate changed 
-			        if (delay != 0) {
-			            queue.Append(Event(NULL, gate->output, nextEvent.eventTime + delay, 
-			            			 gate->ReadOutput(), 1));
-			        }
-			    }
-			    // DFFs have no delay at the moment.
-			    else if (DFF* dff = dynamic_cast<DFF*>(nextEvent.eventComp)) {
-			    	dff->Calculate(nextEvent.eventTime, 1); // Calculate gate change
-			    	queue.Append(Event(NULL, dff->Q, nextEvent.eventTime, dff->ReadQ(), 1));
-			    	queue.Append(Event(NULL, dff->Qn, nextEvent.eventTime, dff->ReadQn(), 1));
-			    }
+// ------------------------------------------------------------------------------------------------------------------
+// The Event Queue can schedule Events with one of two data structures, chosen at runtime: 
+// HEAP_SCHEDULER  : a binary heap (priority queue). O(log n) per Append/Pop. 
+// WHEEL_SCHEDULER : a timing wheel. Events due within the next wheel span go straight into a bucket for their time 
+//                   slot, O(1) per Append/Pop. Events further in the future wait in an overflow heap and move onto the 
+//                   wheel once their time comes within the span. 
+// Both schedulers execute Events in exactly the same order. 
+enum SchedulerType { HEAP_SCHEDULER, WHEEL_SCHEDULER };
 
+// ------------------------------------------------------------------------------------------------------------------
+// This class implements the Event Queue for the system simulators. 
+// The Event Queue is implemented as a priority queue with a custom comparator defined above LessThanTime, or as a 
+// timing wheel backed by that priority queue (see SchedulerType above). 
+// The Event Queue has a total of 4 associated functions used by the simulators defined below. 
+class EventQueue {
+private:
+	SchedulerType scheduler = HEAP_SCHEDULER;
+	long long seqCnt = 0;         // sequence number given to the next appended Event
+	long long popCnt = 0;         // number of Events executed (popped) so far
+	long long peakCnt = 0;        // largest number of Events queued at once
+
+	// Timing wheel. Bucket (t & wheelMask) holds the Events due at time t, for wheelTime <= t < wheelTime + wheel span.
+	// Events in a bucket are in sequence order; heads[b] is the index of the first Event not yet popped from bucket b. 
+	vector<vector<Event>> buckets;
+	vector<int> heads;
+	int wheelMask = 0;
+	int wheelTime = 0;            // time slot under the wheel cursor, every Event on the wheel is at or after it
+	long long wheelCnt = 0;       // number of Events on the wheel
+
+	StimulusStream* stimulus = NULL; // stimulus changes merged into the queue (see Attach)
+	long long stimulusSeq = 0;       // sequence number of the first stimulus change
+
+	// This function moves overflow heap Events that are now within the wheel span onto the wheel. 
+	void Refill() {
+		while (!PQ.empty() && PQ.top().eventTime >= wheelTime && PQ.top().eventTime <= wheelTime + wheelMask) {
+			buckets[PQ.top().eventTime & wheelMask].push_back(PQ.top());
+			wheelCnt++;
+			PQ.pop();
+		}
+	}
+
+	// This function advances the wheel cursor to the earliest time slot holding an Event. 
+	void Advance() {
+		if (wheelCnt == 0) {
+			// nothing on the wheel: jump the cursor straight to the next overflow Event
+			if (!PQ.empty() && PQ.top().eventTime > wheelTime) {
+				wheelTime = PQ.top().eventTime;
+				Refill();
 			}
-			queue.Pop();
+			return;
 		}
+		int b = wheelTime & wheelMask;
+		while (heads[b] == (int)buckets[b].size()) {
+			// slot is spent: recycle its bucket (keeps its capacity) and step the cursor
+			buckets[b].clear();
+			heads[b] = 0;
+			wheelTime++;
+			b = wheelTime & wheelMask;
+			Refill();
+		}
+	}
 
-		VCDFile.close();
+	// This function returns true if the next Event comes from the overflow heap rather than the wheel. 
+	bool NextFromHeap() {
+		if (scheduler == HEAP_SCHEDULER || wheelCnt == 0) {
+			return true;
+		}
+		Advance();
+		if (PQ.empty()) {
+			return false;
+		}
+		int b = wheelTime & wheelMask;
+		return LessThanTime()(buckets[b][heads[b]], PQ.top());
+	}
 
-		// Output completion message
-		cout << "Timing Simulation Complete, waveform stored in TimingSimOutput.vcd" << endl;
+	// This function returns true if the next Event is the current change of the attached stimulus rather than an 
+	// Event held in the queue. 
+	bool NextFromStimulus() {
+		if (stimulus == NULL || stimulus->Empty()) {
+			return false;
+		}
+		if (PQ.empty() && wheelCnt == 0) {
+			return true;
+		}
+		const Event& x = (NextFromHeap()) ? PQ.top() : buckets[wheelTime & wheelMask][heads[wheelTime & wheelMask]];
+		return stimulus->Time() < x.eventTime || (stimulus->Time() == x.eventTime && stimulusSeq + stimulus->Index() < x.seq);
 	}
 
-	// -------------------------------------------- FUNCTIONAL SIMULATION --------------------------------------------------
-	// This Function runs a Functional Simulation on the Circuit. It takes in as an argument the input file as a string. 
-	// Like the Timing Simulation, the Functional Simulation also uses an Event Queueing system but this time, all
-	// Events originating off a changing input will happen at the same time. i.e. there is 0 delay for all Component updates. 
-	void FunctionalSimulation(string z) {
-		string line;
-		int inputTime;
-		ifstream InputFile(z);
-		ofstream VCDFile("FunctionalSimOutput.vcd");
-		VCDFile << "$date " << __DATE__ << " $end\n";
-	    VCDFile << "$version DigiSim Timing Simulator $end\n";
-	    VCDFile << "$timescale 1ns $end\n";
-	    VCDFile << "$scope module circuit $end\n";
-
-	    // Assign unique VCD identifiers
-	    int signalIndex = 1;
-	    unordered_map<string, string> signalMap;
-	    for (set<Node*>::iterator i = nodes.begin(); i != nodes.end(); i++) {
-	        string vcdID = "s" + to_string(signalIndex++);
-	        signalMap[(*i)->name] = vcdID;
-	        VCDFile << "$var wire 1 " << vcdID << " " << (*i)->name << " $end\n";
-	    }
-	    VCDFile << "$upscope $end\n";
-	    VCDFile << "$enddefinitions $end\n";
-
-	    // calculate initial state of circuit amid NAND/NOR/XNOR logic
-	    FuncInit(); // initialize functional sim
-
-		// done calculating initial state
-		// output initial node values at time 0, not all 0
-	    VCDFile << "$dumpvars\n";
-	    for (Node* node : nodes) {
-		    string vcdID = signalMap[node->name];
-		    char vcdValue = (node->CurValue == ONE) ? '1' : '0';
-		    VCDFile << vcdValue << vcdID << "\n";  // Write node value
+	// This function removes and returns the next Event, cancelled or not. 
+	Event Remove() {
+		if (NextFromHeap()) {
+			Event x = PQ.top();
+			PQ.pop();
+			return x;
 		}
-	    VCDFile << "$end\n";
+		int b = wheelTime & wheelMask;
+		wheelCnt--;
+		return buckets[b][heads[b]++];
+	}
 
-		// Finished calculating initial state. Begin Functional Simulation:
-		// Add user defined inputs into the event queue
-		while (getline (InputFile,line)) {
-			stringstream linestream(line);
-			string input;
-			string newVals;
-			LogicValue newVal;
-			float time; 
-			linestream >> time >> input >> newVals;
-			if (newVals == "0") { 
-				newVal = ZERO;
+	// This function discards cancelled Events (and cancelled stimulus changes) from the front of the queue. 
+	void DropCancelled() {
+		while (true) {
+			if (NextFromStimulus()) {
+				if (stimulus->Alive()) {
+					return;
+				}
+				stimulus->Pop();
+				continue;
 			}
-			else if (newVals == "1") { 
-				newVal = ONE;
+			if (PQ.empty() && wheelCnt == 0) {
+				return;
 			}
-			else {
-				newVal = Z;
+			const Event& x = (NextFromHeap()) ? PQ.top() : buckets[wheelTime & wheelMask][heads[wheelTime & wheelMask]];
+			if (x.CompNode != NODE_EVENT || x.gen == x.eventNode->eventGen) {
+				return;
 			}
-
-			// Add changes in input nodes to the event queue
-			inputTime = time; 
-			for (set<Node*>::iterator i = nodes.begin(); i != nodes.end(); i++) {
-				if ((*i)->name == input) {
-					queue.Append(Event(NULL, (*i), inputTime, newVal, 1));
-				}
-			}		
+			Remove();
 		}
+	}
 
+public:
+	priority_queue<Event, vector<Event>, LessThanTime> PQ; // heap scheduler, and overflow heap of the timing wheel
+
+	// This function selects the scheduler. A timing wheel covers span time units past the current time 
+	// (rounded up to a power of 2). The scheduler may only be changed while the queue is empty. 
+	void SetScheduler(SchedulerType type, int span = 1024) {
+		scheduler = type;
+		int size = 64;
+		while (size < span) {
+			size *= 2;
+		}
+		wheelMask = size - 1;
+		buckets.assign(size, vector<Event>());
+		heads.assign(size, 0);
+		wheelCnt = 0;
+	}
 
-		// start executing event queue for this circuit
-		while (!(queue.PQ).empty()) {
-			Event nextEvent = queue.Top();
+	// This function merges a stimulus stream into the queue (NULL detaches it). Its changes execute as Node Events 
+	// appended now, in time order, but are only pulled from the stream when they reach the front of the queue, so 
+	// the queue holds the Events in flight rather than the whole stimulus. 
+	void Attach(StimulusStream* changes) {
+		stimulus = changes;
+		if (stimulus != NULL) {
+			stimulusSeq = Reserve(stimulus->Size());
+			stimulus->Expect();
+		}
+	}
 
-			// if next in Event Queue is a Node then we update the node value and write the change to the output file. 
-			if (nextEvent.CompNode == 1) {
-				nextEvent.eventNode->UpdateValue(nextEvent.nextVal);
-			
+	// This function reserves count sequence numbers and returns the first one. 
+	long long Reserve(long long count) {
+		seqCnt += count;
+		return seqCnt - count;
+	}
 
-				// *****  Write to the output file the change. ***** 
-        		// Write to VCD file
-		        string vcdID = signalMap[nextEvent.eventNode->name];
-		        VCDFile << "#" << nextEvent.eventTime << "\n";
-		        VCDFile << (nextEvent.nextVal == ONE ? "1" : "0") << vcdID << "\n";
-
-
-        		// Additionally, if any gates use this Node as an input then we must add them to the Event Queue. 
-        		for (int k=0; k < compCnt; k++) {
-					vector<string>  names = (comps[k]->ReadInputNames());
-					for (vector<string>::iterator s = names.begin(); s != names.end(); s++) {
-						if ((*s) == nextEvent.eventNode->name) {
-							// Add all components connected to the changing Node to the Event queue
-							//
-							// We check if this input node change is expected to change the output of any gate its connected to. 
-							// If it will, then we cancel the all pending gate changes already in queue, revert the gate, and add the gate
-							// change to the event queue. 
-							//
-							// If the input node change will not change the output of an already pending gate change event then it overrides 
-							// this event and we do nothing.  
-							if (comps[k]->PreCalc() == 1) {
-								queue.Delete(comps[k]->output, comps[k]);
-								queue.Append(Event(comps[k], NULL, nextEvent.eventTime, Z, 0));
-							}
-							break;
-						}
-					}
-				}
-				// Now, if any DFFs use this Node as a clock then we must add the DFF to Event Queue to update
-				// its output values Q, Qn.
-				//
-				// Additionally, if this Node is a D input to a DFF, we must start timers to check for setup
-				// and hold time violations.
-				for (int k=0; k < dffCnt; k++) {
-					if (dffs[k]->CLK->name == nextEvent.eventNode->name) {
-						queue.Append(Event(dffs[k], NULL, nextEvent.eventTime, Z, 0));
-					}
-					// to set timers for calculating setup/hold time violations..
-					if (dffs[k]->D->name == nextEvent.eventNode->name) {
-						dffs[k]->ErrTimersD(nextEvent.eventTime);
-					}
+	// This function adds a passed Event to the Event Queue. An Event appended with a reserved sequence number (see 
+	// Reserve) executes as if it had been appended when the number was reserved. 
+	void Append(Event x, long long seq = -1) {
+		x.seq = (seq >= 0) ? seq : seqCnt++;
+		if (x.CompNode == NODE_EVENT) {
+			x.gen = x.eventNode->eventGen;
+			x.eventNode->pendingEvents++;
+		}
+		if (scheduler == WHEEL_SCHEDULER) {
+			// an empty wheel restarts at the time of the first Event added to it 
+			DropCancelled();
+			if (PQ.empty() && wheelCnt == 0) {
+				wheelTime = x.eventTime;
+			}
+			if (x.eventTime >= wheelTime && x.eventTime <= wheelTime + wheelMask) {
+				// keep the bucket in sequence order
+				int b = x.eventTime & wheelMask;
+				vector<Event>::iterator at = buckets[b].end();
+				while (at != buckets[b].begin() + heads[b] && (at - 1)->seq > x.seq) {
+					at--;
 				}
+				buckets[b].insert(at, x);
+				wheelCnt++;
+				peakCnt = max(peakCnt, (long long)PQ.size() + wheelCnt);
+				return;
 			}
-			// if next in Event Queue is a Component then calculate Component and compute delay
-			else if (nextEvent.CompNode == 0) {
-				// Only apply delay for combinational gates for now..
-				// 
-				// when a gate changes output state, add the output wire node to queue to update
-				// after delay completes
-			    if (ComboLogicGate* gate = dynamic_cast<ComboLogicGate*>(nextEvent.eventComp)) {
-			    	gate->Calculate(); // Calculate gate change
-			        int delay = gate->delay;  // if delay is none zero, output of gate changed 
-			        if (delay != 0) {
-			            queue.Append(Event(NULL, gate->output, nextEvent.eventTime, 
-			            			 gate->ReadOutput(), 1));
-			        }
-			    }
-			    // DFFs have no delay at the moment.
-			    else if (DFF* dff = dynamic_cast<DFF*>(nextEvent.eventComp)) {
-			    	dff->Calculate(nextEvent.eventTime, 0); // Calculate gate change
-			    	queue.Append(Event(NULL, dff->Q, nextEvent.eventTime, dff->ReadQ(), 1));
-			    	queue.Append(Event(NULL, dff->Qn, nextEvent.eventTime, dff->ReadQn(), 1));
-			    }
+		}
+		PQ.push(x);
+		peakCnt = max(peakCnt, (long long)PQ.size() + wheelCnt);
+	}
 
+	// This function removes the top Event from the Event Queue. 
+	void Pop() {
+		popCnt++;
+		if (NextFromStimulus()) {
+			// the stimulus change is no longer pending (unless it was cancelled while it executed)
+			if (stimulus->Alive()) {
+				stimulus->CurNode()->pendingEvents--;
 			}
-			queue.Pop();
+			stimulus->Pop();
+			return;
+		}
+		Event x = Remove();
+		// the Node update is no longer pending (unless it was cancelled while it executed)
+		if (x.CompNode == NODE_EVENT && x.gen == x.eventNode->eventGen) {
+			x.eventNode->pendingEvents--;
 		}
-
-		VCDFile.close();
 	}
 
-	void FuncInit() {
-		// Calculate initial state: start by processing any NAND, NOR, or XNOR gates
-		//
-		//
-		// send any NAND, NOR, XNOR gates to the event queue at time 0
-		for (int i=0; i < compCnt; i++) {
-			comps[i]->Calculate();
-			int delay = comps[i]->delay;
+	// This function deletes all Events in the queue pertaining to an input Node 
+	// It is used when the simulator has to cancel a Node update before the delay has completed. Returns true if 
+	// the queue contained a rotten node update (the caller then reverts the output of the gate driving the Node). 
+	//
+	// Cancelling is O(1): rather than searching the queue, the Node's generation is advanced. The cancelled Events 
+	// stay queued with the old generation stamp and are discarded when they reach the top of the queue. 
+	bool Delete(Node* x) {
+		if (x->pendingEvents != 0) {
+			x->eventGen++;
+			x->pendingEvents = 0;
+			return true;
+		}
+		return false;
+	}
 
-			if (delay != 0) {
-				queue.Append(Event(NULL, comps[i]->output, 0, comps[i]->ReadOutput(), 1));
-			}
+	// This function returns the next Event to be executed in the Event Queue. 
+	Event Top() {
+		DropCancelled();
+		if (NextFromStimulus()) {
+			Event x(-1, stimulus->CurNode(), stimulus->Time(), stimulus->Value(), NODE_EVENT);
+			x.seq = stimulusSeq + stimulus->Index();
+			x.gen = stimulus->CurNode()->eventGen;
+			return x;
 		}
+		if (NextFromHeap()) {
+			return PQ.top();
+		}
+		int b = wheelTime & wheelMask;
+		return buckets[b][heads[b]];
+	}
 
-		// Process all of the NAND, NOR, XNOR gates in queue. 
-		while (!(queue.PQ).empty()) {
-			Event nextEvent = queue.Top();
+	// This function returns true if there are no Events left in the Event Queue. 
+	bool Empty() {
+		DropCancelled();
+		return PQ.empty() && wheelCnt == 0 && (stimulus == NULL || stimulus->Empty());
+	}
 
-			// if next in Event Queue is a Node then we update the node value and write the change to the output file. 
-			if (nextEvent.CompNode == 1) {
-				nextEvent.eventNode->UpdateValue(nextEvent.nextVal);
-
-
-        		// Additionally, if any gates use this Node as an input then we must add them to the Event Queue. 
-        		for (int k=0; k < compCnt; k++) {
-					vector<string>  names = (comps[k]->ReadInputNames());
-					for (vector<string>::iterator s = names.begin(); s != names.end(); s++) {
-						if ((*s) == nextEvent.eventNode->name) {
-							// Add all components connected to the changing Node to the Event queue
-							//
-							// We check if this input node change is expected to change the output of any gate its connected to. 
-							// If it will, then we cancel the all pending gate changes already in queue, revert the gate, and add the gate
-							// change to the event queue. 
-							//
-							// If the input node change will not change the output of an already pending gate change event then it overrides 
-							// this event and we do nothing.  
-							if (comps[k]->PreCalc() == 1) {
-								queue.Delete(comps[k]->output, comps[k]);
-								queue.Append(Event(comps[k], NULL, nextEvent.eventTime, Z, 0));
-							}
-							break;
-						}
-					}
-				}
-				// Now, if any DFFs use this Node as a clock then we must add the DFF to Event Queue to update
-				// its output values Q, Qn.
-				//
-				// Additionally, if this Node is a D input to a DFF, we must start timers to check for setup
-				// and hold time violations.
-				for (int k=0; k < dffCnt; k++) {
-					if (dffs[k]->CLK->name == nextEvent.eventNode->name) {
-						queue.Append(Event(dffs[k], NULL, nextEvent.eventTime, Z, 0));
-					}
-					// to set timers for calculating setup/hold time violations..
-					if (dffs[k]->D->name == nextEvent.eventNode->name) {
-						dffs[k]->ErrTimersD(nextEvent.eventTime);
-					}
-				}
+	// This function returns the number of Events executed so far. 
+	long long Executed() {
+		return popCnt;
+	}
+
+	// This function returns the largest number of Events queued at once so far (attached stimulus changes not 
+	// pulled yet are not queued). 
+	long long Peak() {
+		return peakCnt;
+	}
+};
+
+// ------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ SYMBOL TABLE ----------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This class implements the name-to-index symbol table used by the Circuit to resolve Node names. Every name is
+// interned once into a single contiguous string pool and is given a dense integer index (0, 1, 2, ...) in order of
+// first appearance. Lookups go through an open-addressing hash map (linear probing, power of 2 capacity) whose slots
+// hold name indices, so resolving a name is O(1) on average no matter how many Nodes the netlist defines.
+class SymbolTable {
+private:
+	vector<char> pool;        // interned name characters stored back to back
+	vector<int> offsets;      // offset into the pool of each interned name
+	vector<int> lengths;      // length of each interned name
+	vector<uint32_t> hashes;  // cached hash of each interned name (used when the slot table grows)
+	vector<int> slots;        // hash slots holding a name index, or -1 if the slot is empty
+
+	// FNV-1a hash of a name.
+	static uint32_t Hash(string_view x) {
+		uint32_t h = 2166136261u;
+		for (char c : x) {
+			h = (h ^ (unsigned char)c) * 16777619u;
+		}
+		return h;
+	}
+
+	// This function returns the slot holding name x, or the empty slot where x would be inserted.
+	size_t Probe(string_view x, uint32_t h) const {
+		size_t mask = slots.size() - 1;
+		size_t s = h & mask;
+		while (slots[s] != -1) {
+			int i = slots[s];
+			if (hashes[i] == h && Name(i) == x) {
+				return s;
 			}
-			// if next in Event Queue is a Component then calculate Component and compute delay
-			else if (nextEvent.CompNode == 0) {
-				// Only apply delay for combinational gates for now..
-				// 
-				// when a gate changes output state, add the output wire node to queue to update
-				// after delay completes
-			    if (ComboLogicGate* gate = dynamic_cast<ComboLogicGate*>(nextEvent.eventComp)) {
-			    	gate->Calculate(); // Calculate gate change
-			        int delay = gate->delay;  // if delay is none zero, output of gate changed 
-			        if (delay != 0) {
-			            queue.Append(Event(NULL, gate->output, nextEvent.eventTime, 
-			            			 gate->ReadOutput(), 1));
-			        }
-			    }
-			    // DFFs have no delay at the moment.
-			    else if (DFF* dff = dynamic_cast<DFF*>(nextEvent.eventComp)) {
-			    	dff->Calculate(nextEvent.eventTime); // Calculate gate change
-			    	queue.Append(Event(NULL, dff->Q, nextEvent.eventTime, dff->ReadQ(), 1));
-			    	queue.Append(Event(NULL, dff->Qn, nextEvent.eventTime, dff->ReadQn(), 1));
-			    }
+			s = (s + 1) & mask;
+		}
+		return s;
+	}
 
+	// This function doubles the slot table and re-inserts every interned name.
+	void Grow() {
+		vector<int> bigger((slots.empty()) ? 16 : slots.size()*2, -1);
+		slots.swap(bigger);
+		size_t mask = slots.size() - 1;
+		for (int i = 0; i < (int)offsets.size(); i++) {
+			size_t s = hashes[i] & mask;
+			while (slots[s] != -1) {
+				s = (s + 1) & mask;
 			}
-			queue.Pop();
+			slots[s] = i;
 		}
 	}
 
-	// -------------------------------------------- FUNCTIONAL SIMULATION v2 --------------------------------------------------
-	// This Function runs a Functional Simulation on the Circuit. It takes in as an argument the input file as a string. 
-	// Like the Timing Simulation, the Functional Simulation also uses an Event Queueing system but this time, all
-	// Events originating off a changing input will happen at the same time. i.e. there is 0 delay for all Component updates. 
-	// void FunctionalSimulation2(string z) {
-	//     cout << "Starting Functional Simulation" << endl;
-	//     ofstream OutputFile("FunctionalSimOutputv2.txt");
-	// 	OutputFile << "This file contains the Functional Simulation output:" << endl;
+public:
+	// This function returns the index of name x, or -1 if x was never interned.
+	int Find(string_view x) const {
+		if (slots.empty()) {
+			return -1;
+		}
+		return slots[Probe(x, Hash(x))];
+	}
 
-	//     // Step 1: Propagate inputnodes to get initial state 
-	//     // we do this because of NAND/NOR/XNOR logic which could have initial logic 1
-	//     // when inputs are logical 0
-	//     for (Node* node : inputnodes) {
-	//         Propagate(node, 0, OutputFile, true);
-	//     }
+	// This function returns the index of name x, interning it first if it is new.
+	int Intern(string_view x) {
+		// keep the load factor at or below 1/2 so probe sequences stay short
+		if (2*(offsets.size() + 1) > slots.size()) {
+			Grow();
+		}
+		uint32_t h = Hash(x);
+		size_t s = Probe(x, h);
+		if (slots[s] != -1) {
+			return slots[s];
+		}
+		int i = offsets.size();
+		offsets.push_back(pool.size());
+		lengths.push_back(x.size());
+		hashes.push_back(h);
+		pool.insert(pool.end(), x.begin(), x.end());
+		slots[s] = i;
+		return i;
+	}
 
-	//     // Done calculating initial state: 
-	// 	// next output initial node values to the output file at time 0
-	// 	for (set<Node*>::iterator i = nodes.begin(); i != nodes.end(); i++) {
-	// 		OutputFile << (*i)->name << " " << 0 << " " << (*i)->CurValue << endl;
-	// 	}
+	// This function returns the interned name with index i.
+	string_view Name(int i) const {
+		return string_view(pool.data() + offsets[i], lengths[i]);
+	}
 
-	//     // Step 2: Read input changes into the priority queue
-	//     string line;
-	//     ifstream InputFile(z);
+	// This function returns the number of interned names.
+	int Size() const {
+		return offsets.size();
+	}
 
+	// These functions write the table to a netlist image and read it back, slot table included, so a loaded table 
+	// needs no hashing. Load returns false if the arrays read do not form a table. 
+	void Save(ImageWriter& out) const {
+		out.Array(pool);
+		out.Array(offsets);
+		out.Array(lengths);
+		out.Array(hashes);
+		out.Array(slots);
+	}
+	bool Load(ImageReader& in) {
+		in.Array(pool);
+		in.Array(offsets);
+		in.Array(lengths);
+		in.Array(hashes);
+		in.Array(slots);
+		if (offsets.size() != lengths.size() || offsets.size() != hashes.size() || (slots.size() & (slots.size() - 1)) 
+			|| 2*offsets.size() > slots.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < offsets.size(); i++) {
+			if (offsets[i] < 0 || lengths[i] < 0 || (size_t)offsets[i] + lengths[i] > pool.size()) {
+				return false;
+			}
+		}
+		for (int i : slots) {
+			if (i < -1 || i >= (int)offsets.size()) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
 
-	//     while (getline(InputFile, line)) {
-	//         stringstream linestream(line);
-	//         string input, newVals;
-	//         float time;
-	//         LogicValue newVal;
+// ------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ FANOUT TABLE ----------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This class implements a compressed sparse row (CSR) adjacency table from Node index to the indices of the 
+// components reading that Node. The components reading Node n are Item(Begin(n)) ... Item(End(n)-1), stored 
+// contiguously in the order they were added. The simulators use these tables to find the fanout of a changing Node
+// in O(fanout) integer operations instead of comparing names against every component in the Circuit. 
+class FanoutTable {
+private:
+	vector<int> start;  // start[n] is the offset of Node n's first entry; start[n+1] is one past its last entry
+	vector<int> items;  // component indices grouped by Node
+public:
+	// This function builds the table for nodeCnt Nodes from a list of (Node index, component index) pairs. 
+	// Pairs for the same Node keep their relative order (counting sort). 
+	void Build(int nodeCnt, const vector<pair<int,int>>& pairs) {
+		start.assign(nodeCnt + 1, 0);
+		for (const pair<int,int>& p : pairs) {
+			start[p.first + 1] += 1;
+		}
+		for (int n = 0; n < nodeCnt; n++) {
+			start[n + 1] += start[n];
+		}
+		items.resize(pairs.size());
+		vector<int> fill(start.begin(), start.end() - 1);
+		for (const pair<int,int>& p : pairs) {
+			items[fill[p.first]++] = p.second;
+		}
+	}
 
-	//         linestream >> time >> input >> newVals;
-	//         newVal = (newVals == "1") ? ONE : ZERO;
+	int Begin(int n) const { return start[n]; }
+	int End(int n) const { return start[n + 1]; }
+	int Item(int f) const { return items[f]; }
 
-	//         for (Node* node : nodes) {
-	//             if (node->name == input) {
-	//                 LogicValue oldVal = node->CurValue;  // Store previous value
-	//                 node->UpdateValue(newVal);          // Update value
-	//                 OutputFile << node->name << " " << time << " " << node->CurValue << endl;
+	// These functions write the table to a netlist image and read it back. Load returns false if the arrays read do
+	// not form a table for nodeCnt Nodes with items below itemLimit. 
+	void Save(ImageWriter& out) const {
+		out.Array(start);
+		out.Array(items);
+	}
+	bool Load(ImageReader& in, int nodeCnt, int itemLimit) {
+		in.Array(start);
+		in.Array(items);
+		if ((int)start.size() != nodeCnt + 1 || start[0] != 0 || start[nodeCnt] != (int)items.size()) {
+			return false;
+		}
+		for (int n = 0; n < nodeCnt; n++) {
+			if (start[n] > start[n + 1]) {
+				return false;
+			}
+		}
+		for (int item : items) {
+			if (item < 0 || item >= itemLimit) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
 
-	//                 if (oldVal != node->CurValue) { 
-	//                     Propagate(node, time, OutputFile, false);
-	//                 }
-	//                 break;
-	//             }
-	//         }
-	//     }
-	//     InputFile.close();
-	// }
+// ------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- GATE TABLE -----------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This class stores the combo gates of a netlist as a struct of arrays, indexed by gate (in netlist order). Each gate
+// is an opcode byte, its rise and fall delays, its output Node index and a contiguous run of input Node indices. Gates
+// are evaluated with a switch on the opcode over a Node value array (LogicValue by Node index), so the simulators 
+// never make a virtual call, a dynamic_cast or a Node pointer dereference to evaluate a gate. The table only describes
+// the gates and is shared by every Circuit made from the netlist (see Netlist); the gate outputs of a simulation are 
+// kept in a GateState. 
+class GateTable {
+public:
+	vector<uint8_t> op;        // GateOp of each gate
+	vector<int> rise;          // rise time delay of each gate
+	vector<int> fall;          // fall time delay of each gate
+	vector<int> out;           // output Node index of each gate
+	vector<int> inStart = {0}; // gate g reads the Nodes in[inStart[g]] ... in[inStart[g+1]-1]
+	vector<int> in;            // input Node indices of all gates, back to back
+
+	// This function adds a gate with the passed output Node index and inputCnt input Node indices. 
+	void Add(GateOp gateOp, int riseTime, int fallTime, int output, const int* inputs, int inputCnt) {
+		op.push_back(gateOp);
+		rise.push_back(riseTime);
+		fall.push_back(fallTime);
+		out.push_back(output);
+		in.insert(in.end(), inputs, inputs + inputCnt);
+		inStart.push_back(in.size());
+	}
 
-	// // DFS Function to propagate signal changes
-	// // if initial pass, do not log outputs
-	// void Propagate(Node* node, float time, ofstream& OutputFile, bool ip) {
-	// 	for (int i = 0; i < compCnt; i++) {
-	//         Component* comp = comps[i];
+	// These functions write the gates to a netlist image and read them back. Load returns false if the arrays read 
+	// do not form a table of gates on nodeCnt Nodes. 
+	void Save(ImageWriter& image) const {
+		image.Array(op);
+		image.Array(rise);
+		image.Array(fall);
+		image.Array(out);
+		image.Array(inStart);
+		image.Array(in);
+	}
+	bool Load(ImageReader& image, int nodeCnt) {
+		image.Array(op);
+		image.Array(rise);
+		image.Array(fall);
+		image.Array(out);
+		image.Array(inStart);
+		image.Array(in);
+		size_t gateCnt = out.size();
+		if (op.size() != gateCnt || rise.size() != gateCnt || fall.size() != gateCnt || inStart.size() != gateCnt + 1 || 
+			inStart[0] != 0 || inStart[gateCnt] != (int)in.size()) {
+			return false;
+		}
+		for (size_t g = 0; g < gateCnt; g++) {
+			if (op[g] > XNOR_OP || out[g] < 0 || out[g] >= nodeCnt || inStart[g] > inStart[g + 1] || 
+				inStart[g + 1] - inStart[g] > 8) {
+				return false;
+			}
+		}
+		for (int n : in) {
+			if (n < 0 || n >= nodeCnt) {
+				return false;
+			}
+		}
+		return true;
+	}
 
-	//         // Check if this component has 'node' as an input
-	//         for (int j = 0; j < comp->inputNames.size(); j++) {
-	//             if (comp->inputs[j] == node) { 
-	//                 comp->Calculate();
-	//                 LogicValue oldOutput = comp->output->CurValue;
-	//                 comp->output->UpdateValue(comp->ReadOutput());
+	int Size() const { return out.size(); }
+	int MaxDelay(int g) const { return max(rise[g], fall[g]); }
+
+	// This function returns the output (0/1) gate g would have for the passed Node values. Any value other than 
+	// ZERO counts as 1, like the ComboLogicGate classes. 
+	int Evaluate(int g, const uint8_t* values) const {
+		const int* i = in.data() + inStart[g];
+		const int* end = in.data() + inStart[g + 1];
+		int result = 0;
+		switch (op[g]) {
+			case AND_OP:
+			case NAND_OP:
+				result = 1;
+				for (; i < end; i++) { result &= (values[*i] != ZERO); }
+				break;
+			case OR_OP:
+			case NOR_OP:
+				for (; i < end; i++) { result |= (values[*i] != ZERO); }
+				break;
+			case XOR_OP:
+			case XNOR_OP:
+				for (; i < end; i++) { result ^= (values[*i] != ZERO); }
+				break;
+		}
+		return (op[g] >= NAND_OP) ? (result ^ 1) : result;
+	}
+};
 
-	//                 if (oldOutput != comp->output->CurValue) { 
-	//                 	// record to output if not initial pass through
-	//                 	if (!ip) { OutputFile << comp->output->name << " " << time << " " << comp->output->CurValue << endl; }
-	//                     Propagate(comp->output, time, OutputFile, ip);  // **Recursive DFS call**
-	//                 }
-	//                 break;  // No need to check other inputs if this node matches
-	//             }
-	//         }
-	//     }
-	// }
+// ------------------------------------------------------------------------------------------------------------------
+// This class holds the output value of each gate of a GateTable for one Circuit: the value its output Node has, or 
+// will have once its pending update executes. Calculate and PreCalc behave like the ComboLogicGate functions of the 
+// same names. 
+class GateState {
+public:
+	const GateTable* table = NULL;
+	vector<uint8_t> value;     // current output value (0/1) of each gate
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// This Function changes the passed Node into a stuck-at-y Node where y is passed in. 
-	void CreateStuckAt(string x, LogicValue y) {
-		// Change passed Node to a Stuck-At-y Node. 
-		// loop through all nodes in the circuit
-		for(set<Node*>::iterator k = nodes.begin(); k != nodes.end(); k++) {
-			// if node has same name as passed node then turn it into a stuck-at-y node
-	    	if ((*k)->name == x) {
-	    		(*k)->MakeStuckAt(y); 
-	    	}
-	    }
+	// This function sizes the state for the passed gates, with all outputs 0. 
+	void Attach(const GateTable& gates) {
+		table = &gates;
+		value.assign(gates.Size(), 0);
 	}
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// This helper Function just returns the node names set from the circuit. 
-	set<string> CircuitNodeNames() {
-		return nodeNames;
+	LogicValue Output(int g) const { return (value[g] == 0) ? ZERO : ONE; }
+
+	// This function updates the output of gate g and returns the delay of the change: the rise time for 0->1, the 
+	// fall time for 1->0 and 0 if the output did not change. 
+	int Calculate(int g, const uint8_t* values) {
+		int next = table->Evaluate(g, values);
+		int delay = (next == value[g]) ? 0 : (next == 1) ? table->rise[g] : table->fall[g];
+		value[g] = next;
+		return delay;
 	}
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// This helper Function returns a set of input names from the circuit. 
-	set<string> CircuitInputNames() {
-		set<string> names;
-		for(set<Node*>::iterator k = inputnodes.begin(); k != inputnodes.end(); k++) {
-	        names.insert((*k)->name);
-	    }
-	    return names;
+	// This function returns true if the passed Node values would change the output of gate g. 
+	bool PreCalc(int g, const uint8_t* values) const {
+		return table->Evaluate(g, values) != value[g];
 	}
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// This helper function returns a vector of tuples containing input Node (names, logic value) for the Circuit. 
-	vector<tuple<string,int>> CircuitInputs() {
-		vector<tuple<string, int>> inputs; 
-		for (set<Node*>::iterator i = inputnodes.begin(); i != inputnodes.end(); i++) {
-			inputs.push_back(make_tuple((*i)->name, (*i)->CurValue));
-		}
-		return inputs;
+	// This function sets the output of gate g back to the current value of its output Node, after the pending 
+	// updates of the Node were cancelled. (Going back to the output before the last Calculate is not enough: when 
+	// several inputs of a gate change at one time, the gate can be calculated again with no change before a later 
+	// input cancels the update, and the output would be left at a value its Node never gets.) 
+	void Revert(int g, const uint8_t* values) {
+		value[g] = (values[table->out[g]] == ONE) ? 1 : 0;
 	}
+};
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// This helper function returns a vector of tuples containing input Node (names, logic value) for the Circuit. 
-	vector<tuple<string,int>> CircuitOutputs() {
-		vector<tuple<string, int>> outputs; 
-		for (set<Node*>::iterator i = outputnodes.begin(); i != outputnodes.end(); i++) {
-			outputs.push_back(make_tuple((*i)->name, (*i)->CurValue));
-		}
-		return outputs;
+// ------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------- COMPRESSED WAVEFORMS ----------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// A compressed waveform (.dsw, written instead of a VCD with --waveform dsw) holds the same value changes as the VCD 
+// in blocks. A block holds the changes of a run of time steps grouped by Node. It starts with the block's period: 
+// the most common time between two changes of a Node (a clock period in clocked circuits). Then for each Node with 
+// changes come its index (as the distance from the previous Node with changes), its number of changes * 4 + its 
+// encoding * 2 + its first new value, and the times of its changes in one of two encodings (whichever is smaller): 
+//     0  the greatest common divisor of the times between its changes, then the time of each change as the time 
+//        since its previous change in the block divided by that divisor 
+//     1  (Nodes with at most 64 phases) its phases (the distinct times of its changes after a whole number of 
+//        periods since the block's first time, as their count and their distances), then each change as the 
+//        periods since its previous change * the phase count + the position of its phase, so a Node changing at a 
+//        few fixed points of the clock cycle costs about a byte a change however long the period 
+// all as varints. The later values are not stored: a change always flips the Node. A block is compressed with a 
+// small LZ77 coder (the LZ4 block format, see LZCompress), so repeated runs (e.g. a clock's changes) shrink to a few 
+// bytes. The file is 
+//     header    magic "DSWAVE02", the Node count, the writer version string and the Node names
+//     values    the $dumpvars value of each Node ('0' or '1'), one byte per Node
+//     blocks    first time, last time, change count, size and compressed size, then the compressed changes
+//     index     first time, last time and file offset of each block, then the block count
+//     footer    file offset of the index and the magic again
+// so a reader finds the blocks of a time range from the index without reading the others (see WaveformBlockReader). 
+// Every number is little-endian; strings are a 4-byte length and the bytes. 
+
+const char WAVEFORM_MAGIC[8] = {'D', 'S', 'W', 'A', 'V', 'E', '0', '2'};
+
+// A Node value change: passed to the waveform writer thread (see WaveformRing) and read back from compressed 
+// waveforms (see WaveformBlockReader). 
+struct ValueRecord {
+	long long time;
+	int node;
+	char value;      // '0' or '1'
+};
+
+// This Function appends the LZ4 length extension of n (bytes of 255 and the rest) to out. 
+void LZLength(string& out, size_t n) {
+	for (; n >= 255; n -= 255) {
+		out += (char)255;
 	}
+	out += (char)n;
+}
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// This Function deletes all the components and nodes allocated for this circuit. 
-	void Delete() {
-		// DELETE COMPONENTS
-		for (int i = 0; i < compCnt; i++) {
-			delete comps[i];
+// This Function compresses n bytes into out with a greedy LZ77 coder writing the LZ4 block format: sequences of a 
+// token (literal count and match length - 4, 4 bits each, 15 meaning more follows), the literals, a 2-byte back 
+// offset and the match length extension. Matches are found with a hash table of the last position of each 4-byte 
+// string. The last 12 bytes are always literals, as the format requires. 
+void LZCompress(const uint8_t* src, size_t n, string& out) {
+	vector<uint32_t> table(1 << 14, 0); // hash of 4 bytes -> last position + 1
+	size_t anchor = 0;                  // first byte not yet written
+	for (size_t i = 0; n >= 12 && i + 12 <= n; ) {
+		uint32_t bytes;
+		memcpy(&bytes, src + i, 4);
+		uint32_t h = (bytes * 2654435761u) >> 18;
+		size_t candidate = table[h];
+		table[h] = i + 1;
+		if (candidate == 0 || i - (candidate - 1) > 65535 || memcmp(src + candidate - 1, src + i, 4) != 0) {
+			i++;
+			continue;
 		}
-		for (int i = 0; i < dffCnt; i++) {
-			delete dffs[i];
+		size_t match = candidate - 1, length = 4;
+		while (i + length + 5 < n && src[match + length] == src[i + length]) {
+			length++;
 		}
-
-		// DELETE NODES
-		for (set<Node*>::iterator i = nodes.begin(); i != nodes.end(); i++) {
-			delete (*i);
+		size_t literals = i - anchor, offset = i - match;
+		out += (char)((min(literals, (size_t)15) << 4) | min(length - 4, (size_t)15));
+		if (literals >= 15) {
+			LZLength(out, literals - 15);
 		}
-
+		out.append((const char*)src + anchor, literals);
+		out += (char)(offset & 0xff);
+		out += (char)(offset >> 8);
+		if (length - 4 >= 15) {
+			LZLength(out, length - 4 - 15);
+		}
+		i += length;
+		anchor = i;
 	}
+	size_t literals = n - anchor;
+	out += (char)(min(literals, (size_t)15) << 4);
+	if (literals >= 15) {
+		LZLength(out, literals - 15);
+	}
+	out.append((const char*)src + anchor, literals);
+}
 
-	// ------------------------------------------------------------------------------------------------------------------
-	// Destructor for the Circuit
-	~Circuit(void) { 
-		Delete();
+// This Function decompresses an LZCompress block of n bytes into dst, which must hold exactly dstSize bytes. 
+// Returns false if the block is damaged. 
+bool LZDecompress(const uint8_t* src, size_t n, uint8_t* dst, size_t dstSize) {
+	size_t i = 0, o = 0;
+	auto length = [&](size_t base) -> long long {
+		if (base != 15) {
+			return base;
+		}
+		while (i < n) {
+			uint8_t b = src[i++];
+			base += b;
+			if (b != 255) {
+				return base;
+			}
+		}
+		return -1;
+	};
+	while (i < n) {
+		uint8_t token = src[i++];
+		long long literals = length(token >> 4);
+		if (literals < 0 || (size_t)literals > n - i || (size_t)literals > dstSize - o) {
+			return false;
+		}
+		memcpy(dst + o, src + i, literals);
+		i += literals;
+		o += literals;
+		if (i == n) {
+			break;
+		}
+		if (i + 2 > n) {
+			return false;
+		}
+		size_t offset = src[i] | (src[i + 1] << 8);
+		i += 2;
+		long long matchLength = length(token & 15);
+		if (matchLength < 0 || offset == 0 || offset > o || (size_t)matchLength + 4 > dstSize - o) {
+			return false;
+		}
+		for (long long k = 0; k < matchLength + 4; k++, o++) {
+			dst[o] = dst[o - offset];
+		}
 	}
-};
+	return o == dstSize;
+}
 
-// ----------------------------------------------------------------------------------------------------------------------
-// ------------------------------------------- FAULT VECTOR GENERATOR ---------------------------------------------------
-// ----------------------------------------------------------------------------------------------------------------------
-// This class implements the Fault Vector Generator for the system. The Fault Vector Generator is constructed with a 
-// passed string netlist file. It creates the Circuit object from that netlist as well as additional faulty stuck-at 
-// circuits. For each Node defined in the netlist there will be 2 possible stuck-ats and thus 2 associated faulty Circuits. 
-// The Fault Vector Generator runs randomly generated test vectors on all of these Circuits and detects faults by comparing 
-// the outputs of the "Good" Circuit to the outputs of the "Faulty" Circuits. A fault is detected if the outputs differ. 
-// The generator operates on a trial-and-error basis. On each trial, it runs a number of test vectors on the Good and Faulty
-// Circuits. The number of tests per trial is determined by the number of remaining faults to be detected. After running all 
-// of the tests for a trial, the generator determines which test vector had the best coverage on the remaining faults and 
-// adds it to the list of Fault Vectors. All of the faulty Circuits detected by this max coverage test vector are then 
-// removed before running the next trial. This process continues until the user-input coverage (% faults detected) is satisfied. 
-//. 
-class FaultVectorGenerator {
+// This Function appends the LEB128 varint of x to out. 
+void PutVarint(string& out, uint64_t x) {
+	for (; x >= 0x80; x >>= 7) {
+		out += (char)(x | 0x80);
+	}
+	out += (char)x;
+}
+
+// This Function reads a LEB128 varint at pos, advancing pos. Returns false if the data ends first. 
+bool GetVarint(string_view data, size_t& pos, uint64_t& x) {
+	x = 0;
+	for (int shift = 0; pos < data.size() && shift < 64; shift += 7) {
+		uint8_t b = data[pos++];
+		x |= (uint64_t)(b & 0x7f) << shift;
+		if (b < 0x80) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// This class writes a compressed waveform. Changes must come in time order; they are held until BLOCK_CHANGES have 
+// collected and the time moves on (a time step is never split between blocks), then sorted by Node (keeping the 
+// order of each Node's changes), encoded and compressed into a block. 
+class WaveformBlockWriter {
 private:
-	set<Circuit*> faultyCircuits;
-	Circuit* GoodCircuit;
-public:
-	// The Constructor for the FaultVectorGenerator takes a string input netlist from 
-	// the user and creates circuits for the generator. One correct circuit is created 
-	// along with 2*(# of nodes) faulty circuits each with a single stuck-at-1/0 node. 
-	FaultVectorGenerator(string x) {
-		// Create a Good (No Fault) Circuit
-		GoodCircuit = new Circuit(x);
-		// Grab all node names (including inputs/outputs) for the circuit
-		set<string> allNodeNames = GoodCircuit->CircuitNodeNames();
+	static const size_t BLOCK_CHANGES = 1 << 18;
+	static const size_t PERIOD_SAMPLES = 1 << 12;
+	static const size_t MAX_PHASES = 64;
+	ofstream file;
+	uint64_t offset = 0;                 // bytes written so far
+	int nodeCnt = 0;
+	vector<ValueRecord> changes;         // changes of the block being collected
+	vector<uint32_t> nodeStart;          // counting sort of the changes by Node
+	vector<ValueRecord> sorted;
+	vector<long long> gaps, phases;      // scratch for the block's period and the phases of a Node
+	vector<long long> cycles;            // scratch for the period of each change of a Node
+	vector<size_t> slots, order, rank;   // scratch for the phase of each change of a Node and the phase order
+	vector<uint64_t> index;              // first time, last time and offset of each block written
+	string raw, packed, byDivisor, byPhase;
+
+	void Bytes(const void* data, size_t size) {
+		file.write((const char*)data, size);
+		offset += size;
+	}
+	template <typename T> void Number(T x) {
+		Bytes(&x, sizeof(x));
+	}
+	void String(string_view text) {
+		Number((uint32_t)text.size());
+		Bytes(text.data(), text.size());
+	}
 
-		// Next, create faulty circuit(s)
-		// loop through each node in the circuit
-		for (set<string>::iterator j = allNodeNames.begin(); j != allNodeNames.end(); j++) {
-			// create faulty node stuck-at-0 circuit
-			Circuit *sa0circuit = new Circuit(x);
-			if (sa0circuit) {
-			    sa0circuit->CreateStuckAt((*j), ZERO);
-			    faultyCircuits.insert(sa0circuit);
-			} else {
-			    cerr << "Error: Could not create stuck-at-0 circuit for node " << *j << endl;
+	// This function encodes, compresses and writes the collected changes as one block. 
+	void WriteBlock() {
+		if (changes.empty()) {
+			return;
+		}
+		nodeStart.assign(nodeCnt + 1, 0);
+		for (const ValueRecord& c : changes) {
+			nodeStart[c.node + 1]++;
+		}
+		for (int n = 0; n < nodeCnt; n++) {
+			nodeStart[n + 1] += nodeStart[n];
+		}
+		sorted.resize(changes.size());
+		for (const ValueRecord& c : changes) {
+			sorted[nodeStart[c.node]++] = c;
+		}
+		long long first = changes.front().time, last = changes.back().time;
+		// the block's period is the most common time between two changes of a Node (at different times), taken 
+		// from up to PERIOD_SAMPLES evenly spaced changes
+		gaps.clear();
+		for (size_t c = 1, step = sorted.size() / PERIOD_SAMPLES + 1; c < sorted.size(); c += step) {
+			if (sorted[c].node == sorted[c - 1].node && sorted[c].time != sorted[c - 1].time) {
+				gaps.push_back(sorted[c].time - sorted[c - 1].time);
 			}
-
-			// create faulty node stuck-at-1 circuit 
-			Circuit *sa1circuit = new Circuit(x);
-			if (sa1circuit) {
-			    sa1circuit->CreateStuckAt((*j), ONE);
-			    faultyCircuits.insert(sa1circuit);
-			} else {
-			    cerr << "Error: Could not create stuck-at-1 circuit for node " << *j << endl;
+		}
+		sort(gaps.begin(), gaps.end());
+		long long period = 1;
+		for (size_t g = 0, most = 0; g < gaps.size(); ) {
+			size_t end = upper_bound(gaps.begin() + g, gaps.end(), gaps[g]) - gaps.begin();
+			period = (end - g > most) ? gaps[g] : period;
+			most = max(most, end - g);
+			g = end;
+		}
+		raw.clear();
+		PutVarint(raw, period);
+		int prevNode = -1;
+		for (size_t c = 0; c < sorted.size(); ) {
+			size_t end = c;
+			while (end < sorted.size() && sorted[end].node == sorted[c].node) {
+				end++;
+			}
+			// every change flips the Node (only changes to a new value are written), so only the first value is 
+			// kept. Encoding 0: the distances divided by their greatest common divisor
+			uint64_t scale = 0;
+			long long time = first;
+			for (size_t k = c; k < end && scale != 1; k++) {
+				scale = gcd(scale, (uint64_t)(sorted[k].time - time));
+				time = sorted[k].time;
+			}
+			scale = max(scale, (uint64_t)1);
+			byDivisor.clear();
+			PutVarint(byDivisor, scale);
+			time = first;
+			for (size_t k = c; k < end; k++) {
+				PutVarint(byDivisor, (scale == 1) ? sorted[k].time - time : (sorted[k].time - time) / scale);
+				time = sorted[k].time;
+			}
+			// encoding 1: periods and phases, for Nodes with at most MAX_PHASES phases (a Node changing about once 
+			// a period only divides for longer gaps)
+			byPhase.clear();
+			if (period > 1) {
+				cycles.clear();
+				slots.clear();
+				phases.clear();
+				long long cycle = 0;
+				for (size_t k = c; k < end && phases.size() <= MAX_PHASES; k++) {
+					long long offset = sorted[k].time - first - cycle*period;
+					if (offset >= period) {
+						cycle += offset / period;
+						offset %= period;
+					}
+					size_t slot = find(phases.begin(), phases.end(), offset) - phases.begin();
+					if (slot == phases.size()) {
+						phases.push_back(offset);
+					}
+					cycles.push_back(cycle);
+					slots.push_back(slot);
+				}
+				if (phases.size() <= MAX_PHASES) {
+					// number the phases in increasing order
+					order.resize(phases.size());
+					for (size_t p = 0; p < phases.size(); p++) {
+						order[p] = p;
+					}
+					sort(order.begin(), order.end(), [&](size_t x, size_t y) { return phases[x] < phases[y]; });
+					rank.resize(phases.size());
+					PutVarint(byPhase, phases.size());
+					for (size_t p = 0; p < phases.size(); p++) {
+						rank[order[p]] = p;
+						PutVarint(byPhase, phases[order[p]] - (p ? phases[order[p - 1]] : 0));
+					}
+					cycle = 0;
+					for (size_t k = 0; k < cycles.size() && byPhase.size() < byDivisor.size(); k++) {
+						PutVarint(byPhase, (cycles[k] - cycle) * phases.size() + rank[slots[k]]);
+						cycle = cycles[k];
+					}
+				}
 			}
+			bool byPhases = !byPhase.empty() && byPhase.size() < byDivisor.size();
+			PutVarint(raw, sorted[c].node - prevNode);
+			PutVarint(raw, (uint64_t)(end - c) << 2 | byPhases << 1 | (sorted[c].value == '1'));
+			raw += byPhases ? byPhase : byDivisor;
+			prevNode = sorted[end - 1].node;
+			c = end;
 		}
+		packed.clear();
+		LZCompress((const uint8_t*)raw.data(), raw.size(), packed);
+		index.insert(index.end(), {(uint64_t)first, (uint64_t)last, offset});
+		Number(first);
+		Number(last);
+		Number((uint32_t)changes.size());
+		Number((uint32_t)raw.size());
+		Number((uint32_t)packed.size());
+		Bytes(packed.data(), packed.size());
+		changes.clear();
 	}
 
-	// This Function takes as an integer input (0-100), the amount of coverage % requested
-	// by the user and generates a set of test vectors which achieves that coverage. The 
-	// generated vectors are written to the file TestVectorOutput.txt in the directory the
-	// program is being run from. 
-	// The program has a set bin size of 20 runs in each of which a test vector is generated and
-	// run on all of the faulty circuits. After 10 runs/vectors are tested, the vector providing
-	// the most coverage is selected and written to the file. The number of remaining faults is 
-	// updated before repeating the same process over again. 
-	void Generate(double x) {
-		// required minimum test vector coverage = x
-		double required_coverage = x/double(100);
-		double total_coverage = 0;
-		int total_faults = size(faultyCircuits);
-		int vector_cnt = 0;
+public:
+	// This function creates the file and writes the header naming every Node. 
+	void Open(const string& fileName, const string& version, const vector<Node*>& nodes) {
+		file.open(fileName, ios::binary);
+		offset = 0;
+		nodeCnt = nodes.size();
+		changes.clear();
+		index.clear();
+		Bytes(WAVEFORM_MAGIC, sizeof(WAVEFORM_MAGIC));
+		Number((uint32_t)nodeCnt);
+		String(version);
+		for (Node* node : nodes) {
+			String(node->name);
+		}
+	}
 
-		// Grab input names for the circuit
-		set<string> inputNames = GoodCircuit->CircuitInputNames();
+	// This function writes the $dumpvars value of each Node ('0' or '1'). 
+	void DumpVars(const vector<char>& values) {
+		Bytes(values.data(), nodeCnt);
+	}
 
-		ofstream TestVectorOutput("FaultVectors.txt");
-		TestVectorOutput << "This file contains a set of test vectors providing " << required_coverage*100 << 
-							"% fault coverage on the given circuit: " << endl;
+	// This function records a change of Node n to value ('0' or '1') at the passed time. 
+	void Change(long long time, int n, char value) {
+		if (changes.size() >= BLOCK_CHANGES && time != changes.back().time) {
+			WriteBlock();
+		}
+		changes.push_back(ValueRecord{time, n, value});
+	}
 
-		while ((required_coverage - total_coverage) > 0.001) {
-			// # of test vector cases to run this trial is equal to the number of the remaining faults left to 
-			// detect for the circuit. This way, we only run 1 test vector per trial when there is 1 fault 
-			// remaining. 
-			int caseCnt = faultyCircuits.size();
-			// responses to each test vector
-			vector<tuple<int,set<Circuit*>,vector<tuple<string,int>>>> responses;
-			// Get seed for pseudo-random number generator.
-			srand(time(0));
-			for (int i = 0; i<caseCnt; i++) {
-				// Create test vector 
-				string testVectorName = "testVector.txt";
-				ofstream Vector(testVectorName);
-				for (set<string>::iterator i = inputNames.begin(); i != inputNames.end(); i++) {
-					// Generate random bit (0/1)
-					int randombit = rand() % 2;
-					// Create test value for input
-					Vector << 0 << " " << (*i) << " " << randombit << endl;
-				}
-				Vector.close();
+	// This function writes the last block, the index and the footer, and closes the file. 
+	void Close() {
+		WriteBlock();
+		uint64_t indexOffset = offset;
+		Bytes(index.data(), index.size()*sizeof(uint64_t));
+		Number((uint64_t)(index.size() / 3));
+		Number(indexOffset);
+		Bytes(WAVEFORM_MAGIC, sizeof(WAVEFORM_MAGIC));
+		file.close();
+	}
+};
 
-				// Calculate coverage of this test vector
-				tuple<int,set<Circuit*>,vector<tuple<string,int>>> vector_coverage = Calculate(testVectorName);
-				// Add the coverage of this test to the list of all responses
-				responses.push_back(vector_coverage);
+// This class reads a compressed waveform in place from a memory map. Open reads the header, the $dumpvars values 
+// and the block index; ReadBlock decompresses one block; Blocks finds the blocks of a time range. 
+class WaveformBlockReader {
+private:
+	unique_ptr<MappedFile> map;
+	string_view data;
+	vector<uint8_t> raw;
+	vector<long long> phases;
+
+	// This function reads a T at pos, advancing pos. Returns false if the data ends first. 
+	template <typename T> bool Number(size_t& pos, T& x) {
+		if (pos + sizeof(T) > data.size()) {
+			return false;
+		}
+		memcpy(&x, data.data() + pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
 
-				// Convert test vector file name to array of chars so we can remove it. 
-				const char* testVectorNameChars = testVectorName.c_str();
-				remove (testVectorNameChars);
+public:
+	struct Block {
+		long long first, last;   // times of the first and last change in the block
+		uint64_t offset;         // file offset of the block
+	};
+	string version;              // version string of the writer (for the VCD header)
+	vector<string> names;        // Node names by index
+	string values;               // $dumpvars value of each Node
+	vector<Block> blocks;
+
+	// This function opens a compressed waveform. Returns false if it is not a complete compressed waveform. 
+	bool Open(const string& fileName) {
+		map = make_unique<MappedFile>(fileName);
+		data = map->Text();
+		size_t pos = sizeof(WAVEFORM_MAGIC);
+		uint32_t nodeCnt, length;
+		uint64_t indexOffset = 0, blockCnt = 0;
+		if (data.size() < 2*sizeof(WAVEFORM_MAGIC) + 2*sizeof(uint64_t) || 
+		    memcmp(data.data(), WAVEFORM_MAGIC, sizeof(WAVEFORM_MAGIC)) != 0 || 
+		    memcmp(data.data() + data.size() - sizeof(WAVEFORM_MAGIC), WAVEFORM_MAGIC, sizeof(WAVEFORM_MAGIC)) != 0 ||
+		    !Number(pos, nodeCnt) || !Number(pos, length) || pos + length > data.size()) {
+			return false;
+		}
+		version = string(data.substr(pos, length));
+		pos += length;
+		names.clear();
+		for (uint32_t n = 0; n < nodeCnt; n++) {
+			if (!Number(pos, length) || pos + length > data.size()) {
+				return false;
 			}
+			names.push_back(string(data.substr(pos, length)));
+			pos += length;
+		}
+		if (pos + nodeCnt > data.size()) {
+			return false;
+		}
+		values = string(data.substr(pos, nodeCnt));
+		size_t end = data.size() - sizeof(WAVEFORM_MAGIC) - sizeof(uint64_t);
+		Number(end, indexOffset);
+		end = data.size() - sizeof(WAVEFORM_MAGIC) - 2*sizeof(uint64_t);
+		Number(end, blockCnt);
+		if (indexOffset > data.size() || blockCnt > (data.size() - indexOffset) / (3*sizeof(uint64_t))) {
+			return false;
+		}
+		blocks.resize(blockCnt);
+		for (size_t b = 0; b < blockCnt; b++) {
+			uint64_t entry[3];
+			memcpy(entry, data.data() + indexOffset + b*sizeof(entry), sizeof(entry));
+			blocks[b] = Block{(long long)entry[0], (long long)entry[1], entry[2]};
+		}
+		return true;
+	}
 
-			// returns a pointer to the largest coverage tuple in the vector of responses. 
-			auto largest_coverage = max_element(responses.begin(), responses.end(),
-	                                            [](const tuple<int, set<Circuit*>, vector<tuple<string,int>>> &x,
-	                                            const tuple<int, set<Circuit*>, vector<tuple<string,int>>> &y) {
-	                                            return get<0>(x) < get<0>(y);
-	                                           });
-
-			set<Circuit*> faults_covered = get<1>(*largest_coverage);
-			total_coverage += ((double)get<0>(*largest_coverage)/(double)total_faults);
+	// This function returns the indices of the blocks holding changes at times from first to last. 
+	pair<size_t, size_t> Blocks(long long first, long long last) const {
+		size_t begin = lower_bound(blocks.begin(), blocks.end(), first, 
+		                           [](const Block& b, long long t) { return b.last < t; }) - blocks.begin();
+		size_t end = upper_bound(blocks.begin(), blocks.end(), last, 
+		                         [](long long t, const Block& b) { return t < b.first; }) - blocks.begin();
+		return make_pair(begin, max(begin, end));
+	}
 
-			// Only record test vector if it detected faults 
-			if (get<0>(*largest_coverage) != 0) {
-				cout << "Total Coverage: " << total_coverage*100 << "%" << endl;
-				for (set<Circuit*>::iterator j = faults_covered.begin(); j != faults_covered.end(); j++) {
-					faultyCircuits.erase(*j);
+	// This function decompresses block b and appends its changes to out, grouped by Node in index order and in time 
+	// order within a Node. Returns false if the block is damaged. 
+	bool ReadBlock(size_t b, vector<ValueRecord>& out) {
+		size_t pos = blocks[b].offset;
+		long long first, last;
+		uint32_t changeCnt, rawSize, packedSize;
+		if (!Number(pos, first) || !Number(pos, last) || !Number(pos, changeCnt) || !Number(pos, rawSize) || 
+		    !Number(pos, packedSize) || pos + packedSize > data.size()) {
+			return false;
+		}
+		raw.resize(rawSize);
+		if (!LZDecompress((const uint8_t*)data.data() + pos, packedSize, raw.data(), rawSize)) {
+			return false;
+		}
+		string_view changes((const char*)raw.data(), rawSize);
+		size_t p = 0;
+		uint64_t period;
+		if (!GetVarint(changes, p, period) || period == 0) {
+			return false;
+		}
+		long long node = -1;
+		for (uint32_t c = 0; c < changeCnt; ) {
+			uint64_t step, header, scale, x;
+			if (!GetVarint(changes, p, step) || !GetVarint(changes, p, header) || !GetVarint(changes, p, scale) || 
+			    header < 4 || (header >> 2) > changeCnt - c) {
+				return false;
+			}
+			node += step;
+			if (node >= (long long)names.size()) {
+				return false;
+			}
+			// encoding 1 starts with the phase count (in place of the divisor), then the phases
+			bool byPhases = header & 2;
+			if (byPhases && (scale == 0 || scale > (header >> 2))) {
+				return false;
+			}
+			phases.clear();
+			for (uint64_t k = 0, phase = 0; byPhases && k < scale; k++) {
+				if (!GetVarint(changes, p, x)) {
+					return false;
+				}
+				phases.push_back(phase += x);
+			}
+			long long time = first, cycle = 0;
+			char value = (header & 1) ? '1' : '0';
+			for (uint64_t k = 0; k < (header >> 2); k++, c++) {
+				if (!GetVarint(changes, p, x)) {
+					return false;
+				}
+				if (byPhases) {
+					cycle += x / scale;
+					time = first + cycle * period + phases[x % scale];
 				}
+				else {
+					time += x * scale;
+				}
+				out.push_back(ValueRecord{time, (int)node, value});
+				value = (value == '1') ? '0' : '1';
+			}
+		}
+		return true;
+	}
+};
 
-				// Make header
-				vector_cnt += 1;
-				TestVectorOutput << "---------------" << " Test Vector #" << vector_cnt << " ---------------" << endl;
+// ------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ WAVEFORM DATABASE -----------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// A waveform database (.wdb, written next to the waveform with --waveform-db) holds the value changes of a 
+// simulation column by column so they can be queried without reading a VCD again. The changes of each Node are one 
+// run of the times and values columns, in time order, starting with the $dumpvars value at time 0 (a change to the 
+// value the Node already has is never stored, and 'x' marks dumping turned off). Every INDEX_STRIDE-th time of each 
+// run is copied into a sparse time index, small enough to stay in cache, so a query binary searches the index and 
+// then one stride of the run: O(log n) in the changes of the Node. Node names are stored with their indices sorted 
+// by name, so Find is a binary search too. 
+//
+// The file is a netlist-image style image (see ImageWriter) of the columns below, and Load maps it and points the 
+// columns into the mapping, so a database of any size opens without parsing or copying anything: 
+//     counts      Node count, change count, index entry count
+//     runStart    the run of Node n is times/values[runStart[n] ... runStart[n+1]-1]
+//     times       change times
+//     values      change values ('0', '1' or 'x')
+//     indexStart  the sparse index of Node n is indexTimes[indexStart[n] ... indexStart[n+1]-1]
+//     indexTimes  times[runStart[n] + k*INDEX_STRIDE] for each k
+//     nameStart   the name of Node n is nameText[nameStart[n] ... nameStart[n+1]-1]
+//     nameText    the Node names, back to back
+//     byName      the Node indices in name order
+//     version     the writer version string
+
+const uint32_t WAVEFORM_DB_VERSION = 1;
+const char WAVEFORM_DB_MAGIC[8] = {'D', 'S', 'W', 'A', 'V', 'E', 'D', 'B'};
+
+// The changes of one Node in a time range: count changes, at times[0 ... count-1] taking values[0 ... count-1]. 
+struct WaveformSpan {
+	const long long* times;
+	const char* values;
+	size_t count;
+};
 
-				// Write test vector under header
-				vector<tuple<string,int>> testvector = get<2>(*largest_coverage);
-				for (vector<tuple<string,int>>::iterator k = testvector.begin(); k != testvector.end(); k++) {
-					TestVectorOutput << get<0>(*k) << " " << get<1>(*k) << endl;
-				}
+// This class is the waveform database. It is filled by Record (the VCDWriter records what it dumps, see 
+// WaveformOptions::database) and turned into columns by Finish, or opened from a file by Load; the query functions 
+// work the same on either. 
+class WaveformDatabase {
+private:
+	static const size_t INDEX_STRIDE = 64;
+	vector<ValueRecord> log;        // changes recorded since Open, in time order
+	vector<char> last;              // last recorded value of each Node
+	vector<uint64_t> ownRunStart, ownIndexStart;
+	vector<long long> ownTimes, ownIndexTimes;
+	vector<char> ownValues;
+	vector<uint32_t> ownNameStart;
+	string ownNameText;
+	vector<int> ownByName;
+	unique_ptr<MappedFile> map;     // the file the columns point into (loaded databases only)
+	size_t nodeCnt = 0;
+	const uint64_t* runStart = NULL;
+	const long long* times = NULL;
+	const char* values = NULL;
+	const uint64_t* indexStart = NULL;
+	const long long* indexTimes = NULL;
+	const uint32_t* nameStart = NULL;
+	const char* nameText = NULL;
+	const int* byName = NULL;
+
+	// This function points the columns at the owned arrays. 
+	void UseOwnColumns() {
+		nodeCnt = ownNameStart.size() - 1;
+		runStart = ownRunStart.data();
+		times = ownTimes.data();
+		values = ownValues.data();
+		indexStart = ownIndexStart.data();
+		indexTimes = ownIndexTimes.data();
+		nameStart = ownNameStart.data();
+		nameText = ownNameText.data();
+		byName = ownByName.data();
+	}
 
-				TestVectorOutput << "Total Coverage = " << total_coverage << endl;
+	// This function returns the position of the first change of Node n after the passed time. 
+	uint64_t After(int n, long long time) const {
+		const long long* index = indexTimes + indexStart[n];
+		size_t blocks = upper_bound(index, indexTimes + indexStart[n+1], time) - index;
+		if (blocks == 0) {
+			return runStart[n];
+		}
+		const long long* first = times + runStart[n] + (blocks - 1)*INDEX_STRIDE;
+		const long long* end = times + min(runStart[n] + blocks*INDEX_STRIDE, runStart[n+1]);
+		return upper_bound(first, end, time) - times;
+	}
+
+public:
+	string version;
+
+	// This function starts recording a waveform of the passed Nodes (their positions in the list are the Node 
+	// numbers used by Record and the queries). 
+	void Open(const string& writerVersion, const vector<Node*>& nodes) {
+		version = writerVersion;
+		log.clear();
+		last.assign(nodes.size(), 0);
+		ownNameStart.assign(1, 0);
+		ownNameText.clear();
+		for (Node* node : nodes) {
+			ownNameText += node->name;
+			ownNameStart.push_back(ownNameText.size());
+		}
+	}
+
+	// This function records Node n taking the passed value at the passed time (times must not decrease), unless it 
+	// already has that value. 
+	void Record(long long time, int n, char value) {
+		if (value != last[n]) {
+			last[n] = value;
+			log.push_back(ValueRecord{time, n, value});
+		}
+	}
+
+	// This function turns the recorded changes into the columns (a counting sort of the changes by Node, which keeps 
+	// each Node's changes in time order) and builds the sparse index and the name order. 
+	void Finish() {
+		size_t n = ownNameStart.size() - 1;
+		ownRunStart.assign(n + 1, 0);
+		for (const ValueRecord& r : log) {
+			ownRunStart[r.node + 1]++;
+		}
+		for (size_t i = 0; i < n; i++) {
+			ownRunStart[i + 1] += ownRunStart[i];
+		}
+		ownTimes.resize(log.size());
+		ownValues.resize(log.size());
+		vector<uint64_t> next(ownRunStart.begin(), ownRunStart.end() - 1);
+		for (const ValueRecord& r : log) {
+			ownTimes[next[r.node]] = r.time;
+			ownValues[next[r.node]++] = r.value;
+		}
+		log.clear();
+		log.shrink_to_fit();
+		ownIndexStart.assign(1, 0);
+		ownIndexTimes.clear();
+		for (size_t i = 0; i < n; i++) {
+			for (uint64_t c = ownRunStart[i]; c < ownRunStart[i + 1]; c += INDEX_STRIDE) {
+				ownIndexTimes.push_back(ownTimes[c]);
 			}
+			ownIndexStart.push_back(ownIndexTimes.size());
+		}
+		ownByName.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			ownByName[i] = i;
+		}
+		UseOwnColumns();
+		sort(ownByName.begin(), ownByName.end(), [this](int x, int y) { return Name(x) < Name(y); });
+	}
+
+	// This function writes the database to a file. Returns false if it could not be written. 
+	bool Save(const string& file) const {
+		ImageWriter image(file, 0, 0, WAVEFORM_DB_MAGIC, WAVEFORM_DB_VERSION);
+		uint64_t counts[3] = {nodeCnt, runStart[nodeCnt], indexStart[nodeCnt]};
+		image.Array(counts, 3);
+		image.Array(runStart, nodeCnt + 1);
+		image.Array(times, counts[1]);
+		image.Array(values, counts[1]);
+		image.Array(indexStart, nodeCnt + 1);
+		image.Array(indexTimes, counts[2]);
+		image.Array(nameStart, nodeCnt + 1);
+		image.Array(nameText, nameStart[nodeCnt]);
+		image.Array(byName, nodeCnt);
+		image.Array(version.data(), version.size());
+		return image.Close();
+	}
 
+	// This function maps a database file and points the columns into it. Returns false, leaving the database 
+	// empty, if the file is missing, not a waveform database of this version, or damaged. 
+	bool Load(const string& file) {
+		*this = WaveformDatabase();
+		map = make_unique<MappedFile>(file, false);
+		ImageReader image(map->Text());
+		size_t n, changes, entries, cnt[8];
+		const uint64_t* counts = image.Header(0, 0, WAVEFORM_DB_MAGIC, WAVEFORM_DB_VERSION) ? image.Array<uint64_t>(n) : NULL;
+		if (counts == NULL || n != 3) {
+			*this = WaveformDatabase();
+			return false;
 		}
+		n = counts[0];
+		changes = counts[1];
+		entries = counts[2];
+		runStart = image.Array<uint64_t>(cnt[0]);
+		times = image.Array<long long>(cnt[1]);
+		values = image.Array<char>(cnt[2]);
+		indexStart = image.Array<uint64_t>(cnt[3]);
+		indexTimes = image.Array<long long>(cnt[4]);
+		nameStart = image.Array<uint32_t>(cnt[5]);
+		nameText = image.Array<char>(cnt[6]);
+		byName = image.Array<int>(cnt[7]);
+		size_t versionLength;
+		const char* versionText = image.Array<char>(versionLength);
+		bool valid = image.Ok() && cnt[0] == n + 1 && cnt[1] == changes && cnt[2] == changes && cnt[3] == n + 1 && 
+		             cnt[4] == entries && cnt[5] == n + 1 && runStart[0] == 0 && runStart[n] == changes && 
+		             indexStart[0] == 0 && indexStart[n] == entries && nameStart[0] == 0 && nameStart[n] == cnt[6] && 
+		             cnt[7] == n;
+		for (size_t i = 0; valid && i < n; i++) {
+			valid = runStart[i] <= runStart[i + 1] && indexStart[i] <= indexStart[i + 1] && 
+			        indexStart[i + 1] - indexStart[i] == (runStart[i + 1] - runStart[i] + INDEX_STRIDE - 1)/INDEX_STRIDE && 
+			        nameStart[i] <= nameStart[i + 1] && byName[i] >= 0 && (size_t)byName[i] < n;
+		}
+		if (!valid) {
+			*this = WaveformDatabase();
+			return false;
+		}
+		nodeCnt = n;
+		version.assign(versionText, versionLength);
+		return true;
+	}
 
-		TestVectorOutput.close();
+	// This function returns the number of Nodes. 
+	int Nodes() const { return nodeCnt; }
+
+	// This function returns the name of Node n. 
+	string_view Name(int n) const { return string_view(nameText + nameStart[n], nameStart[n+1] - nameStart[n]); }
+
+	// This function returns the Node with the passed name, or -1. 
+	int Find(string_view name) const {
+		const int* p = lower_bound(byName, byName + nodeCnt, name, [this](int x, string_view y) { return Name(x) < y; });
+		return (p != byName + nodeCnt && Name(*p) == name) ? *p : -1;
 	}
 
-// -----------------------------------------------------------------------------------------------------------------------
-	/*
-	This function takes as an input a filename to a test vector. The Calculate function
-	then runs functional simulations on the normal circuit as well as faulty circuits with 
-	stuck-at-faults. The function returns with the integer coverage of the test vector
-	and a set of pointers to all the detected stuck-at-fault circuits. Also returned is 
-	the test vector itself -> names and values of the inputs. 
-	*/
-	tuple<int,set<Circuit*>,vector<tuple<string,int>>> Calculate(string x) {
-		// Make set of pointers to faulty circuits. At the end we will return with the 
-		// set of faulty circuits that were detected. 
-		set<Circuit*> bustedCircuits;
+	// This function returns the value of Node n at the passed time (after the changes at that time), or 'x' before 
+	// time 0. 
+	char ValueAt(int n, long long time) const {
+		uint64_t p = After(n, time);
+		return (p == runStart[n]) ? 'x' : values[p - 1];
+	}
 
-		// Run functional simulation on the test vector.
-		GoodCircuit->FunctionalSimulation(x);
-		// Grab the test vector as well to return it 
-		vector<tuple<string,int>> test_inputs = GoodCircuit->CircuitInputs();
+	// This function returns the changes of Node n from time from to time to (both included). 
+	WaveformSpan Transitions(int n, long long from, long long to) const {
+		uint64_t first = After(n, from - 1), end = max(first, After(n, to));
+		return WaveformSpan{times + first, values + first, end - first};
+	}
 
-		// Grab functional simulation correct outputs; 
-		vector<tuple<string,int>> correctoutputs = GoodCircuit->CircuitOutputs();
+	// This function returns the number of times Node n changed value from time from to time to (both included). 
+	// The $dumpvars value is not a change. 
+	size_t ToggleCount(int n, long long from, long long to) const {
+		WaveformSpan span = Transitions(n, from, to);
+		return span.count - (span.count > 0 && span.times == times + runStart[n]);
+	}
 
-		// Next, simulate faulty circuit(s) on the same test vector
-		int detectedFaults = 0;
-		for (set<Circuit*>::iterator i = faultyCircuits.begin(); i != faultyCircuits.end(); i++) {
-			(*i)->FunctionalSimulation(x);
+	// This function returns the total number of values stored ($dumpvars values included). 
+	size_t Changes() const { return nodeCnt ? runStart[nodeCnt] : 0; }
+};
 
-			vector<tuple<string,int>> faultyoutputs = (*i)->CircuitOutputs();
-			vector<tuple<string,int>> reorder_faultyoutputs; 
-			for (vector<tuple<string,int>>::iterator j = correctoutputs.begin(); j != correctoutputs.end(); j++) {
-				for (vector<tuple<string,int>>::iterator k = faultyoutputs.begin(); k != faultyoutputs.end(); k++) {
-					if (get<0>(*j) == get<0>(*k)) {
-						reorder_faultyoutputs.push_back(*k);
-					}
+// ------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- VCD WRITER -----------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This class is a lock-free single-producer single-consumer ring of ValueRecords. The simulator thread pushes, the 
+// waveform writer thread pops; each side only writes its own position, so no locks are needed. When the ring is 
+// full the producer waits for the writer (backpressure) and the wait is added to StallSeconds. When the ring is 
+// empty the consumer sleeps in Wait. The producer does not wake it on every push, only once per WAKE_BATCH records, 
+// when the ring is full and on Close, so the consumer runs in batches and a push costs no lock. 
+class WaveformRing {
+private:
+	static const size_t CAPACITY = 1 << 16;     // records (a power of 2)
+	static const size_t WAKE_BATCH = CAPACITY / 4;
+	vector<ValueRecord> slots;
+	alignas(64) atomic<size_t> head{0};         // records pushed (written by the producer)
+	alignas(64) atomic<size_t> tail{0};         // records popped (written by the consumer)
+	alignas(64) size_t tailSeen = 0;            // the producer's last read of tail
+	double stallSeconds = 0;                    // time the producer waited for a full ring
+	mutex lock;
+	condition_variable ready;                   // signalled to wake the consumer
+	atomic<bool> sleeping{false};               // the consumer is in Wait
+	atomic<bool> closed{false};                 // no more records will be pushed
+
+	// This function wakes the consumer if it is sleeping. The fence orders the producer's last head store before its 
+	// read of sleeping (the consumer fences between its store of sleeping and its read of head), so either the 
+	// producer sees the consumer sleeping or the consumer sees the records. 
+	void Wake() {
+		atomic_thread_fence(memory_order_seq_cst);
+		if (sleeping.load()) {
+			lock_guard<mutex> guard(lock);
+			ready.notify_one();
+		}
+	}
+
+public:
+	WaveformRing() : slots(CAPACITY) {}
+
+	// This function adds a record, waiting while the ring is full. Called by the producer only. 
+	void Push(const ValueRecord& record) {
+		size_t h = head.load(memory_order_relaxed);
+		if (h - tailSeen == CAPACITY) {
+			tailSeen = tail.load(memory_order_acquire);
+			if (h - tailSeen == CAPACITY) {
+				auto start = chrono::steady_clock::now();
+				while (h - tailSeen == CAPACITY) {
+					Wake();
+					this_thread::yield();
+					tailSeen = tail.load(memory_order_acquire);
 				}
+				stallSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
 			}
+		}
+		slots[h & (CAPACITY - 1)] = record;
+		head.store(h + 1, memory_order_release);
+		if ((h + 1) % WAKE_BATCH == 0) {
+			Wake();
+		}
+	}
 
-			if (reorder_faultyoutputs != correctoutputs) { 
-				detectedFaults += 1; 
-				bustedCircuits.insert((*i));
-			}
+	// This function tells the consumer no more records will come and wakes it. Called by the producer only. 
+	void Close() {
+		{
+			lock_guard<mutex> guard(lock);
+			closed.store(true);
 		}
+		ready.notify_one();
+	}
 
-		// We return with the following values below:
-		// 1.) the # of detected faults by this test vector
-		// 2.) pointers to the faulty circuits that were detected
-		// 3.) input test vector names & values
-		return {detectedFaults, bustedCircuits, test_inputs};
+	// This function returns true once Close was called. 
+	bool Closed() const { return closed.load(memory_order_acquire); }
+
+	// This function sleeps until the producer wakes the consumer with records to pop, or closes the ring. Called by 
+	// the consumer only, after PopAll found nothing. 
+	void Wait() {
+		unique_lock<mutex> guard(lock);
+		sleeping.store(true);
+		atomic_thread_fence(memory_order_seq_cst);
+		while (head.load() == tail.load(memory_order_relaxed) && !closed.load()) {
+			ready.wait(guard);
+		}
+		sleeping.store(false);
 	}
 
-	~FaultVectorGenerator(void) { 
-		// delete faulty Circuits 
-		for (set<Circuit*>::iterator i = faultyCircuits.begin(); i != faultyCircuits.end(); i++) {
-			delete (*i);
+	// This function passes every record pushed so far to consume and frees their slots. Returns the number of 
+	// records consumed. Called by the consumer only. 
+	template <typename Consume> size_t PopAll(Consume consume) {
+		size_t t = tail.load(memory_order_relaxed);
+		size_t h = head.load(memory_order_acquire);
+		for (size_t r = t; r != h; r++) {
+			consume(slots[r & (CAPACITY - 1)]);
 		}
-		// delete good Circuit
-		delete GoodCircuit;
+		tail.store(h, memory_order_release);
+		return h - t;
 	}
+
+	double StallSeconds() const { return stallSeconds; }
 };
 
+// This Function returns true if the whole name matches the glob pattern, where * matches any run of characters and 
+// ? any one character. 
+bool GlobMatch(string_view pattern, string_view name) {
+	size_t p = 0, n = 0, star = string_view::npos, starName = 0;
+	while (n < name.size()) {
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+			p++;
+			n++;
+		}
+		else if (p < pattern.size() && pattern[p] == '*') {
+			star = p++;
+			starName = n;
+		}
+		else if (star != string_view::npos) {
+			p = star + 1;
+			n = ++starName;
+		}
+		else {
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == '*') {
+		p++;
+	}
+	return p == pattern.size();
+}
+
+// The waveform options of a simulation (set from the command line, see Circuit::SetWaveformOptions). The defaults 
+// write a VCD of every Node on the simulator thread. 
+struct WaveformOptions {
+	bool async = false;      // format and write on a writer thread (see WaveformRing)
+	bool compressed = false; // write compressed waveforms instead of VCDs (see WaveformBlockWriter)
+	vector<string> dumpPatterns;  // --dump: Node name globs, or @inputs, @outputs, @dffs (none: all)
+	vector<string> dumpRegexes;   // --dump-regex: regular expressions matching whole Node names
+	vector<pair<long long, long long>> dumpWindows; // --dump-window: dump only from first to second
+	bool database = false;   // also record a waveform database (see WaveformDatabase)
+};
+
+// This class writes the VCD waveform of a simulation, working from Node indices. Each Node gets a short printable 
+// identifier (base 94, "!" to "~"), a "#time" line is only written when the time moves on, a change is only written 
+// if it differs from the Node's last written value, and everything goes through one pre-sized buffer that is 
+// written to the file when full. 
+//
+// The functional simulators record changes with Change: they are collected per time step and written when the 
+// simulation moves on to a later time, giving the final value of every Node that ended the step with a different 
+// value than last written (in Node index order). The file only depends on the Node values at the end of each time 
+// step, so every functional simulation engine writes the same bytes for the same circuit and stimulus. The timing 
+// simulators write each Node Event as it executes with Write. 
+//
+// The WaveformOptions passed to SetOptions choose how the waveform is written. With async set (--async-waveform), 
+// the changes after $dumpvars are pushed as ValueRecords into a WaveformRing and formatted and written to the file 
+// by a writer thread, so the simulation and the file output overlap. The file is the same either way. With 
+// compressed set (--waveform dsw), the changes that would be written to the VCD are written to a compressed 
+// waveform (.dsw, see WaveformBlockWriter) instead. With database set (--waveform-db), the dumped changes are also 
+// recorded into a WaveformDatabase, saved next to the waveform (.wdb) by Close. 
+//
+// Select limits the waveform to some Nodes and times. Nodes not selected are left out of the header, and their 
+// changes are dropped on entry (by a lookup of the Node's position among the selected Nodes), before any other 
+// work. Dumping is turned off and on at the $dumpoff/$dumpon times of the input file and around the --dump-window 
+// windows: while off, only the last value of each Node is kept, and turning on writes a $dumpon block of the 
+// current values (a compressed waveform gets the values that changed while off). Everything past the selection 
+// works on positions among the selected Nodes, so a compressed waveform only holds the selected Nodes. 
+class VCDWriter {
+private:
+	static const size_t BUFFER_SIZE = 1 << 20;
+	WaveformOptions options;  // how the waveform is written (see SetOptions)
+	ofstream file;
+	vector<char> buffer;      // output not yet written to the file
+	size_t used = 0;          // bytes of buffer in use
+	string idText;            // VCD identifiers of all Nodes, back to back
+	vector<uint32_t> idStart; // identifier of Node n is idText[idStart[n] ... idStart[n+1]-1]
+	vector<char> written;     // last value written for each Node
+	vector<char> pending;     // value of each Node at its last change in the current time step
+	vector<char> isChanged;   // 1 if the Node changed during the current time step
+	vector<int> changed;      // Nodes changed during the current time step
+	int stepTime = 0;         // time of the current time step
+	long long timeWritten = -1; // time of the last "#time" line
+	unique_ptr<WaveformRing> ring; // changes waiting for the writer thread (async only)
+	thread writer;                 // the writer thread (async only)
+	double stallSeconds = 0;       // time the simulation waited for the writer thread
+	unique_ptr<WaveformBlockWriter> blocks; // the compressed waveform written in place of the VCD (compressed only)
+	vector<char> mask;             // 1 for each Node to dump, by Node index (empty: every Node, see Select)
+	vector<int> slot;              // Node index -> position among the dumped Nodes, or -1 if the Node is not dumped
+	vector<char> current;          // last value of each dumped Node, also while dumping is off
+	vector<pair<long long, bool>> marks; // times dumping turns on (true) or off (false), in time order
+	size_t nextMark = 0;           // first mark not applied yet
+	bool dumping = true;           // false between a $dumpoff and the next $dumpon
+	unique_ptr<WaveformDatabase> db; // the waveform database recorded alongside the waveform (database only)
+	string dbFile;                   // the file the waveform database is saved to on Close
+
+	// This function appends text to the buffer, writing the buffer to the file first if it would overflow. 
+	void Put(const char* text, size_t length) {
+		if (used + length > buffer.size()) {
+			file.write(buffer.data(), used);
+			used = 0;
+			if (length > buffer.size()) {
+				file.write(text, length);
+				return;
+			}
+		}
+		memcpy(buffer.data() + used, text, length);
+		used += length;
+	}
+
+	void Put(string_view text) {
+		Put(text.data(), text.size());
+	}
+
+	// This function writes a "#time" line unless the last one was for the same time. 
+	void PutTime(long long time) {
+		if (time != timeWritten) {
+			char line[24] = "#";
+			char* end = to_chars(line + 1, line + sizeof(line) - 1, time).ptr;
+			*end++ = '\n';
+			Put(line, end - line);
+			timeWritten = time;
+		}
+	}
+
+	// This function writes a value change line for Node n. 
+	void PutChange(int n, char value) {
+		char line[8];
+		size_t length = idStart[n+1] - idStart[n];
+		line[0] = value;
+		memcpy(line + 1, idText.data() + idStart[n], length);
+		line[length + 1] = '\n';
+		Put(line, length + 2);
+		written[n] = value;
+	}
+
+	// This function turns dumping on or off at the marks up to the passed time. 
+	void ApplyMarks(long long time) {
+		for (; nextMark < marks.size() && marks[nextMark].first <= time; nextMark++) {
+			long long markTime = marks[nextMark].first;
+			bool on = marks[nextMark].second;
+			if (on == dumping) {
+				continue;
+			}
+			dumping = on;
+			for (size_t n = 0; db && n < current.size(); n++) {
+				db->Record(markTime, n, on ? current[n] : 'x');
+			}
+			if (blocks) {
+				for (size_t n = 0; on && n < current.size(); n++) {
+					if (current[n] != written[n]) {
+						blocks->Change(markTime, n, current[n]);
+						written[n] = current[n];
+					}
+				}
+				continue;
+			}
+			PutTime(markTime);
+			Put(on ? "$dumpon\n" : "$dumpoff\n");
+			for (size_t n = 0; n < current.size(); n++) {
+				PutChange(n, on ? current[n] : 'x');
+			}
+			Put("$end\n");
+		}
+	}
+
+	// This function writes a change of dumped Node n at the passed time, unless it is the Node's last written value
+	// or dumping is off. 
+	void Format(long long time, int n, char value) {
+		if (nextMark < marks.size() && marks[nextMark].first <= time) {
+			ApplyMarks(time);
+		}
+		current[n] = value;
+		if (!dumping) {
+			return;
+		}
+		if (db) {
+			db->Record(time, n, value);
+		}
+		if (value != written[n] && blocks) {
+			blocks->Change(time, n, value);
+			written[n] = value;
+		}
+		else if (value != written[n]) {
+			PutTime(time);
+			PutChange(n, value);
+		}
+	}
+
+	// This function writes a change, or passes it to the writer thread if there is one. 
+	void Emit(long long time, int n, char value) {
+		if (ring) {
+			ring->Push(ValueRecord{time, n, value});
+		}
+		else {
+			Format(time, n, value);
+		}
+	}
+
+	// This function is the loop of the writer thread: format the records in the ring until Close. 
+	void WriterLoop() {
+		while (true) {
+			bool last = ring->Closed();
+			size_t cnt = ring->PopAll([this](const ValueRecord& r) { Format(r.time, r.node, r.value); });
+			if (last && cnt == 0) {
+				return;
+			}
+			if (cnt == 0) {
+				ring->Wait();
+			}
+		}
+	}
+
+	// This function writes the changes of the current time step. 
+	void Flush() {
+		sort(changed.begin(), changed.end());
+		for (int n : changed) {
+			isChanged[n] = 0;
+			Emit(stepTime, n, pending[n]);
+		}
+		changed.clear();
+	}
+
+public:
+	// This function sets the options of the waveform (see WaveformOptions). Call it before Select and Open. 
+	void SetOptions(const WaveformOptions& waveformOptions) {
+		options = waveformOptions;
+	}
+
+	// This function returns the passed VCD file name with its .vcd ending replaced by the passed one. 
+	static string WithExtension(const string& vcdFile, const char* extension) {
+		size_t dot = vcdFile.rfind(".vcd");
+		return ((dot != string::npos && dot + 4 == vcdFile.size()) ? vcdFile.substr(0, dot) : vcdFile) + extension;
+	}
+
+	// This function returns the file written in place of the passed VCD file: the VCD file itself, or the same 
+	// name ending in .dsw if the waveform is compressed. 
+	string OutputFile(const string& vcdFile) const {
+		return options.compressed ? WithExtension(vcdFile, ".dsw") : vcdFile;
+	}
+
+	// This function returns the waveform database file written next to the passed VCD file. 
+	static string DatabaseFile(const string& vcdFile) {
+		return WithExtension(vcdFile, ".wdb");
+	}
+
+	// This function limits the waveform to the Nodes set in dumpMask (by Node index; empty for every Node) and to 
+	// the times dumping is on: inside the dumpWindows of the options, and as turned off and on by the passed marks 
+	// (time, true for $dumpon), see ReadDumpMarks. Call it before Open. 
+	void Select(const vector<char>& dumpMask, const vector<pair<long long, bool>>& dumpMarks) {
+		mask = dumpMask;
+		marks = dumpMarks;
+		if (!options.dumpWindows.empty()) {
+			marks.push_back(make_pair(0LL, false));
+		}
+		for (const pair<long long, long long>& window : options.dumpWindows) {
+			marks.push_back(make_pair(window.first, true));
+			marks.push_back(make_pair(window.second, false));
+		}
+		stable_sort(marks.begin(), marks.end(), 
+		            [](const pair<long long, bool>& x, const pair<long long, bool>& y) { return x.first < y.first; });
+	}
+
+	// This function opens the VCD file and writes the header declaring every dumped Node in the passed list (all 
+	// of them unless Select was called). If the options are compressed, the compressed waveform 
+	// OutputFile(fileName) is written instead. 
+	void Open(string fileName, string version, const vector<Node*>& nodes) {
+		vector<Node*> dumped;
+		slot.assign(nodes.size(), -1);
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (mask.empty() || mask[i]) {
+				slot[i] = dumped.size();
+				dumped.push_back(nodes[i]);
+			}
+		}
+		written.assign(dumped.size(), '0');
+		current.assign(dumped.size(), '0');
+		pending.assign(dumped.size(), '0');
+		isChanged.assign(dumped.size(), 0);
+		changed.clear();
+		stepTime = 0;
+		timeWritten = -1;
+		nextMark = 0;
+		dumping = true;
+		db.reset();
+		if (options.database) {
+			db = make_unique<WaveformDatabase>();
+			db->Open(version, dumped);
+			dbFile = DatabaseFile(fileName);
+		}
+		if (options.compressed) {
+			blocks = make_unique<WaveformBlockWriter>();
+			blocks->Open(OutputFile(fileName), version, dumped);
+			return;
+		}
+		file.open(fileName, ios::binary);
+		buffer.assign(BUFFER_SIZE, 0);
+		used = 0;
+		Put("$date " __DATE__ " $end\n");
+		Put("$version " + version + " $end\n");
+		Put("$timescale 1ns $end\n");
+		Put("$scope module circuit $end\n");
+
+		// Assign unique VCD identifiers: the digits of the Node index in base 94, least significant first
+		idText.clear();
+		idStart.assign(1, 0);
+		for (size_t i = 0; i < dumped.size(); i++) {
+			size_t id = i;
+			do {
+				idText += (char)('!' + id % 94);
+				id /= 94;
+			} while (id > 0);
+			idStart.push_back(idText.size());
+			Put("$var wire 1 ");
+			Put(string_view(idText).substr(idStart[i], idStart[i+1] - idStart[i]));
+			Put(" " + dumped[i]->name + " $end\n");
+		}
+		Put("$upscope $end\n");
+		Put("$enddefinitions $end\n");
+	}
+
+	// This function writes the $dumpvars block holding the current value of every dumped Node (followed by a 
+	// $dumpoff block if dumping is off at time 0). 
+	void DumpVars(const vector<Node*>& nodes) {
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (slot[i] >= 0) {
+				current[slot[i]] = (nodes[i]->CurValue == ONE) ? '1' : '0';
+			}
+		}
+		written = current;
+		for (size_t n = 0; db && n < current.size(); n++) {
+			db->Record(0, n, current[n]);
+		}
+		if (blocks) {
+			blocks->DumpVars(written);
+		}
+		else {
+			Put("$dumpvars\n");
+			for (size_t n = 0; n < current.size(); n++) {
+				PutChange(n, current[n]);
+			}
+			Put("$end\n");
+		}
+		for (; nextMark < marks.size() && marks[nextMark].first <= 0; nextMark++) {
+			dumping = marks[nextMark].second;
+		}
+		if (!dumping) {
+			dumping = true;
+			marks.insert(marks.begin() + nextMark, make_pair(0LL, false));
+			ApplyMarks(0);
+		}
+		if (options.async && !ring) {
+			ring = make_unique<WaveformRing>();
+			writer = thread(&VCDWriter::WriterLoop, this);
+		}
+	}
+
+	// This function records the current value of a Node that was updated at the passed time. 
+	void Change(Node* node, int time) {
+		int n = slot[node->index];
+		if (n < 0) {
+			return;
+		}
+		if (time != stepTime) {
+			Flush();
+			stepTime = time;
+		}
+		pending[n] = (node->CurValue == ONE) ? '1' : '0';
+		if (!isChanged[n]) {
+			isChanged[n] = 1;
+			changed.push_back(n);
+		}
+	}
+
+	// This function writes Node n taking the passed value at the passed time (times must not decrease). 
+	void Write(int n, LogicValue value, long long time) {
+		if (slot[n] >= 0) {
+			Emit(time, slot[n], (value == ONE) ? '1' : '0');
+		}
+	}
+
+	// This function writes the last time step, waits for the writer thread and closes the file. 
+	void Close() {
+		Flush();
+		if (ring) {
+			ring->Close();
+			writer.join();
+			stallSeconds = ring->StallSeconds();
+			ring.reset();
+		}
+		if (db) {
+			db->Finish();
+			if (!db->Save(dbFile)) {
+				cerr << "Error: could not write waveform database " << dbFile << endl;
+			}
+			db.reset();
+		}
+		if (blocks) {
+			blocks->Close();
+			blocks.reset();
+			return;
+		}
+		file.write(buffer.data(), used);
+		used = 0;
+		file.close();
+	}
+
+	// This function returns the time the simulation waited for the writer thread (0 unless async). 
+	double StallSeconds() const { return stallSeconds; }
+
+	~VCDWriter(void) {
+		if (ring) {
+			ring->Close();
+			writer.join();
+		}
+	}
+};
+
+// This Function converts a compressed waveform to a VCD file holding the same value changes (changes at one time in 
+// Node index order), for viewers that only read VCDs. Returns false if the waveform cannot be read. 
+bool ConvertWaveformToVCD(string waveformFile, string vcdFile) {
+	WaveformBlockReader reader;
+	if (!reader.Open(waveformFile)) {
+		return false;
+	}
+	vector<Node*> nodes;
+	for (size_t n = 0; n < reader.names.size(); n++) {
+		nodes.push_back(new Node(reader.names[n], n));
+		nodes[n]->CurValue = (reader.values[n] == '1') ? ONE : ZERO;
+	}
+	VCDWriter VCDFile;
+	VCDFile.Open(vcdFile, reader.version, nodes);
+	VCDFile.DumpVars(nodes);
+	bool ok = true;
+	vector<ValueRecord> changes;
+	for (size_t b = 0; ok && b < reader.blocks.size(); b++) {
+		changes.clear();
+		ok = reader.ReadBlock(b, changes);
+		stable_sort(changes.begin(), changes.end(), 
+		            [](const ValueRecord& x, const ValueRecord& y) { return x.time < y.time; });
+		for (const ValueRecord& c : changes) {
+			VCDFile.Write(c.node, (c.value == '1') ? ONE : ZERO, c.time);
+		}
+	}
+	VCDFile.Close();
+	for (Node* node : nodes) {
+		delete node;
+	}
+	return ok;
+}
+
+// This Function prints the value of a Node at time from, its number of toggles from time from to time to, and its 
+// changes in that range (one "time Node value" line each, the input file format), from a waveform database. 
+// Returns false if the database cannot be read or has no such Node. 
+bool QueryWaveformDatabase(string dbFile, string name, long long from, long long to) {
+	if (from > to) {
+		cerr << "Error: the query range " << from << " to " << to << " ends before it starts" << endl;
+		return false;
+	}
+	WaveformDatabase db;
+	if (!db.Load(dbFile)) {
+		cerr << "Error: " << dbFile << " is not a waveform database" << endl;
+		return false;
+	}
+	int n = db.Find(name);
+	if (n < 0) {
+		cerr << "Error: " << dbFile << " holds no Node " << name << endl;
+		return false;
+	}
+	cout << "Value of " << name << " at " << from << ": " << db.ValueAt(n, from) << endl;
+	cout << "Toggles of " << name << " from " << from << " to " << to << ": " << db.ToggleCount(n, from, to) << endl;
+	WaveformSpan span = db.Transitions(n, from, to);
+	for (size_t c = 0; c < span.count; c++) {
+		cout << span.times[c] << "  " << name << "  " << span.values[c] << "\n";
+	}
+	cout.flush();
+	return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ PATTERN KERNELS -------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// The pattern kernels evaluate the gates of a Circuit over packed input patterns (see Circuit::SimulatePatterns). 
+// The gates are flattened into a PatternProgram in level order and every Node value is a run of 64-bit words in 
+// one contiguous array (Node n at values[n*words]), so the kernels read gate inputs without chasing Node pointers. 
+// The scalar kernel evaluates 64 patterns per gate (1 word per Node), the AVX2 kernel 256 (4 words) and the 
+// AVX-512 kernel 512 (8 words). The SIMD kernels are compiled for their instruction sets with target attributes 
+// so the rest of the program still runs on any x86 CPU, and the widest kernel the CPU supports is picked at runtime. 
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DIGISIM_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+enum PatternKernel { SCALAR_KERNEL, AVX2_KERNEL, AVX512_KERNEL };
+
+// Gates flattened for the pattern kernels, in level order. Gate g computes op[g] (a GateOp) over the Nodes 
+// in[inStart[g]] ... in[inStart[g+1]-1] and writes the result to Node out[g]. 
+struct PatternProgram {
+	vector<int> op;
+	vector<int> out;
+	vector<int> inStart = {0};
+	vector<int> in;
+};
+
+// This Function returns the number of 64-bit words per Node value used by the passed kernel. 
+int PatternKernelWords(PatternKernel kernel) {
+	return (kernel == AVX512_KERNEL) ? 8 : (kernel == AVX2_KERNEL) ? 4 : 1;
+}
+
+// This Function returns true if the CPU running the program supports the passed kernel. 
+bool PatternKernelSupported(PatternKernel kernel) {
+#ifdef DIGISIM_X86_KERNELS
+	if (kernel == AVX512_KERNEL) {
+		return __builtin_cpu_supports("avx512f");
+	}
+	if (kernel == AVX2_KERNEL) {
+		return __builtin_cpu_supports("avx2");
+	}
+	return true;
+#else
+	return kernel == SCALAR_KERNEL;
+#endif
+}
+
+// This Function returns the widest kernel supported by the CPU. 
+PatternKernel DetectPatternKernel() {
+	if (PatternKernelSupported(AVX512_KERNEL)) {
+		return AVX512_KERNEL;
+	}
+	return PatternKernelSupported(AVX2_KERNEL) ? AVX2_KERNEL : SCALAR_KERNEL;
+}
+
+// This Function evaluates the program over 64 patterns (1 word per Node). 
+void RunPatternsScalar(const PatternProgram& prog, uint64_t* values) {
+	for (size_t g = 0; g < prog.out.size(); g++) {
+		const int* in = prog.in.data() + prog.inStart[g];
+		int inCnt = prog.inStart[g+1] - prog.inStart[g];
+		uint64_t word = 0;
+		switch (prog.op[g] % 3) {
+			case AND_OP:
+				word = ~0ULL;
+				for (int i = 0; i < inCnt; i++) { word &= values[in[i]]; }
+				break;
+			case OR_OP:
+				for (int i = 0; i < inCnt; i++) { word |= values[in[i]]; }
+				break;
+			case XOR_OP:
+				for (int i = 0; i < inCnt; i++) { word ^= values[in[i]]; }
+				break;
+		}
+		values[prog.out[g]] = (prog.op[g] >= NAND_OP) ? ~word : word;
+	}
+}
+
+#ifdef DIGISIM_X86_KERNELS
+// This Function evaluates the program over 256 patterns (4 words per Node) with AVX2. 
+__attribute__((target("avx2")))
+void RunPatternsAVX2(const PatternProgram& prog, uint64_t* values) {
+	const __m256i ones = _mm256_set1_epi64x(-1);
+	for (size_t g = 0; g < prog.out.size(); g++) {
+		const int* in = prog.in.data() + prog.inStart[g];
+		int inCnt = prog.inStart[g+1] - prog.inStart[g];
+		__m256i word = _mm256_setzero_si256();
+		switch (prog.op[g] % 3) {
+			case AND_OP:
+				word = ones;
+				for (int i = 0; i < inCnt; i++) {
+					word = _mm256_and_si256(word, _mm256_loadu_si256((const __m256i*)(values + 4*(size_t)in[i])));
+				}
+				break;
+			case OR_OP:
+				for (int i = 0; i < inCnt; i++) {
+					word = _mm256_or_si256(word, _mm256_loadu_si256((const __m256i*)(values + 4*(size_t)in[i])));
+				}
+				break;
+			case XOR_OP:
+				for (int i = 0; i < inCnt; i++) {
+					word = _mm256_xor_si256(word, _mm256_loadu_si256((const __m256i*)(values + 4*(size_t)in[i])));
+				}
+				break;
+		}
+		if (prog.op[g] >= NAND_OP) {
+			word = _mm256_xor_si256(word, ones);
+		}
+		_mm256_storeu_si256((__m256i*)(values + 4*(size_t)prog.out[g]), word);
+	}
+}
+
+// This Function evaluates the program over 512 patterns (8 words per Node) with AVX-512. 
+__attribute__((target("avx512f")))
+void RunPatternsAVX512(const PatternProgram& prog, uint64_t* values) {
+	const __m512i ones = _mm512_set1_epi64(-1);
+	for (size_t g = 0; g < prog.out.size(); g++) {
+		const int* in = prog.in.data() + prog.inStart[g];
+		int inCnt = prog.inStart[g+1] - prog.inStart[g];
+		__m512i word = _mm512_setzero_si512();
+		switch (prog.op[g] % 3) {
+			case AND_OP:
+				word = ones;
+				for (int i = 0; i < inCnt; i++) {
+					word = _mm512_and_si512(word, _mm512_loadu_si512(values + 8*(size_t)in[i]));
+				}
+				break;
+			case OR_OP:
+				for (int i = 0; i < inCnt; i++) {
+					word = _mm512_or_si512(word, _mm512_loadu_si512(values + 8*(size_t)in[i]));
+				}
+				break;
+			case XOR_OP:
+				for (int i = 0; i < inCnt; i++) {
+					word = _mm512_xor_si512(word, _mm512_loadu_si512(values + 8*(size_t)in[i]));
+				}
+				break;
+		}
+		if (prog.op[g] >= NAND_OP) {
+			word = _mm512_xor_si512(word, ones);
+		}
+		_mm512_storeu_si512(values + 8*(size_t)prog.out[g], word);
+	}
+}
+#endif
+
+// This Function evaluates the program with the passed kernel. The values array holds PatternKernelWords(kernel) 
+// words per Node. 
+void RunPatternKernel(PatternKernel kernel, const PatternProgram& prog, uint64_t* values) {
+#ifdef DIGISIM_X86_KERNELS
+	if (kernel == AVX512_KERNEL) {
+		RunPatternsAVX512(prog, values);
+		return;
+	}
+	if (kernel == AVX2_KERNEL) {
+		RunPatternsAVX2(prog, values);
+		return;
+	}
+#endif
+	RunPatternsScalar(prog, values);
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------- NATIVE CODE MODULES -----------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// The compiled functional simulation (Circuit::FunctionalSimulationCompiled) turns a netlist into straight-line C++ 
+// (see Circuit::GenerateNativeCode), compiles it with the local g++ into a shared object and loads it with dlopen. 
+// Compiled modules are cached in the digisim_cache directory under the hash of the netlist file contents, so only 
+// the first run on a netlist pays the compile time. Loading modules needs dlopen, so on other platforms the compiled 
+// simulation falls back to the levelized one. 
+#if defined(__unix__) || defined(__APPLE__)
+#define DIGISIM_NATIVE_MODULES 1
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+// Version of the generated code. Bump it whenever GenerateNativeCode changes so stale cached modules are not used. 
+const int NATIVE_CODE_VERSION = 1;
+
+// Simulation state passed to a compiled module. The generated code declares the same struct (see GenerateNativeCode). 
+struct NativeState {
+	uint8_t* values;     // value of each Node by index (Circuit::values)
+	uint8_t* gateValues; // output value of each gate (GateState::value)
+	uint8_t* dffState;   // 4 bytes per DFF: clocked flags, last clock state, Q value, Qn value
+	uint32_t* dirty;     // gates with a changed input: bit i of word w is the gate at level order position 32*w+i
+	uint8_t* changed;    // 1 for each Node changed since the caller last cleared it
+	int* changedList;    // indices of the changed Nodes
+	int changedCnt;      // number of changed Nodes
+};
+
+// Functions exported by a compiled module. "digisim_set" sets a Node, recording the change and marking the DFFs and 
+// gates reading the Node. "digisim_settle" finishes a time step like Circuit::SettleLevelized: clocked DFFs latch, 
+// then the dirty gates are evaluated in level order, until no DFF is clocked. 
+typedef void (*NativeSet)(NativeState* state, int n, uint8_t value);
+typedef void (*NativeSettle)(NativeState* state);
+
+// This class loads the compiled module of a netlist, compiling and caching it first if needed. 
+class NativeModule {
+private:
+	void* handle = NULL;
+	static inline mutex loading;   // held while a module is generated, compiled or loaded (batch threads share the cache)
+public:
+	NativeSet set = NULL;
+	NativeSettle settle = NULL;
+
+	// This function returns the path of the cached module file named key with the passed extension (.cpp or .so). 
+	static string Path(const string& key, const string& extension) {
+		return "digisim_cache/" + key + extension;
+	}
+
+	// This function loads the module named key (the netlist hash) from the cache. If it is not cached, generate 
+	// is called to write its C++ source and the source is compiled. The module must have been generated for a 
+	// Circuit of the passed shape (Node, gate and DFF counts). Returns false, after printing why, on failure. 
+	bool Load(const string& key, const int shape[3], function<void(ostream&)> generate) {
+#ifdef DIGISIM_NATIVE_MODULES
+		lock_guard<mutex> guard(loading);
+		string library = Path(key, ".so");
+		error_code ec;
+		if (!filesystem::exists(library, ec)) {
+			// write and compile under temporary names and rename, so a concurrent run never reads a half written 
+			// source or loads a half written module
+			string suffix = "." + to_string(getpid()) + "." + to_string(std::hash<thread::id>()(this_thread::get_id()));
+			string source = Path(key, ".cpp"), tempSource = Path(key, suffix + ".cpp"), temp = library + suffix;
+			filesystem::create_directories("digisim_cache", ec);
+			ofstream Source(tempSource);
+			generate(Source);
+			Source.close();
+			if (ec || Source.fail()) {
+				cerr << "Error: could not write " << tempSource << endl;
+				filesystem::remove(tempSource, ec);
+				return false;
+			}
+			string command = "g++ -O1 -shared -fPIC -o " + temp + " " + tempSource;
+			cout << "Compiling netlist: " << command << endl;
+			if (system(command.c_str()) != 0) {
+				cerr << "Error: could not compile " << tempSource << endl;
+				filesystem::remove(temp, ec);
+				filesystem::remove(tempSource, ec);
+				return false;
+			}
+			filesystem::rename(tempSource, source, ec);
+			if (ec) {
+				filesystem::remove(tempSource, ec);
+			}
+			filesystem::rename(temp, library, ec);
+			if (ec) {
+				cerr << "Error: could not write " << library << endl;
+				filesystem::remove(temp, ec);
+				return false;
+			}
+		}
+		handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+		if (handle == NULL) {
+			cerr << "Error: could not load " << library << ": " << dlerror() << endl;
+			return false;
+		}
+		const int* moduleShape = (const int*)dlsym(handle, "digisim_shape");
+		set = (NativeSet)dlsym(handle, "digisim_set");
+		settle = (NativeSettle)dlsym(handle, "digisim_settle");
+		if (moduleShape == NULL || set == NULL || settle == NULL || moduleShape[0] != shape[0] || moduleShape[1] != shape[1] || 
+			moduleShape[2] != shape[2]) {
+			cerr << "Error: " << library << " does not match the netlist (delete it to rebuild)" << endl;
+			Close();
+			return false;
+		}
+		return true;
+#else
+		cerr << "Compiled simulation is not supported on this platform" << endl;
+		return false;
+#endif
+	}
+
+	// This function unloads the module. 
+	void Close() {
+#ifdef DIGISIM_NATIVE_MODULES
+		if (handle != NULL) {
+			dlclose(handle);
+		}
+#endif
+		handle = NULL;
+		set = NULL;
+		settle = NULL;
+	}
+
+	~NativeModule(void) {
+		Close();
+	}
+};
+
+// ------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- WORKER POOL ----------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This class runs jobs on a fixed set of threads. Run(job) calls job(w) once for every worker w = 0 ... Size()-1 
+// (worker 0 on the calling thread) and returns when all the calls have finished. The threads are created once and 
+// sleep between jobs, so a simulator can hand the pool many small jobs. 
+class WorkerPool {
+private:
+	vector<thread> threads;
+	mutex lock;
+	condition_variable start;  // signalled when a job is posted (or the pool stops)
+	condition_variable finish; // signalled when the last worker finishes the job
+	function<void(int)> job;
+	long long jobCnt = 0;      // number of jobs posted so far
+	int running = 0;           // workers (other than worker 0) still running the current job
+	bool stopping = false;
+
+	// This function is the loop run by worker w: wait for a job, run it, report back. 
+	void Work(int w) {
+		long long done = 0;
+		unique_lock<mutex> guard(lock);
+		while (true) {
+			start.wait(guard, [&] { return stopping || jobCnt != done; });
+			if (stopping) {
+				return;
+			}
+			done = jobCnt;
+			guard.unlock();
+			job(w);
+			guard.lock();
+			if (--running == 0) {
+				finish.notify_one();
+			}
+		}
+	}
+
+public:
+	WorkerPool(int threadCnt) {
+		for (int w = 1; w < threadCnt; w++) {
+			threads.emplace_back(&WorkerPool::Work, this, w);
+		}
+	}
+
+	int Size() const { return threads.size() + 1; }
+
+	// This function runs work(w) on every worker and waits for all of them. 
+	void Run(function<void(int)> work) {
+		{
+			lock_guard<mutex> guard(lock);
+			job = work;
+			running = threads.size();
+			jobCnt++;
+		}
+		start.notify_all();
+		work(0);
+		unique_lock<mutex> guard(lock);
+		finish.wait(guard, [&] { return running == 0; });
+	}
+
+	~WorkerPool(void) {
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		start.notify_all();
+		for (thread& t : threads) {
+			t.join();
+		}
+	}
+};
+
+// ------------------------------------------------------------------------------------------------------------------
+// --------------------------------------------------- NETLIST ------------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This class holds everything derived from a netlist file that does not change while simulating: the interned Node 
+// names, the gate table, the DFF and clock declarations, the fanout tables, the input/output Nodes and the logic 
+// levels, all by Node/gate/DFF index. A Netlist is read once and never changed after, so any number of Circuits 
+// (and threads) can share it (see Circuit(shared_ptr<const Netlist>)); each Circuit only adds its own Node values, 
+// gate outputs, DFF states and stuck-at Nodes. 
+class Netlist {
+public:
+	string file;                   // the netlist file
+	SymbolTable symbols;           // name-to-index table for all Node names
+	GateTable gates;               // the combo gates (see GateTable)
+	vector<int> dffNodes;          // D, CLK, Q and Qn Node index of each DFF
+	vector<float> dffTimes;        // setup and hold time of each DFF
+	vector<ClockSource> clocks;    // clock generators (their node is set by each Circuit, see clockNodes)
+	vector<int> clockNodes;        // index of the Node driven by each clock
+	FanoutTable gateFanout;        // Node index -> indices of combo gates reading the Node
+	FanoutTable clockFanout;       // Node index -> indices of DFFs clocked by the Node
+	FanoutTable dataFanout;        // Node index -> indices of DFFs with the Node on their D input
+	vector<int> inputs;            // indices of the input Nodes (driven by no combo gate), ascending
+	vector<int> outputs;           // indices of the output Nodes (read by no combo gate), ascending
+	bool levelized = false;        // true if the combo gates form no loops (see Levelize)
+	vector<int> gateLevel;         // logic level of each combo gate (0 = fed only by inputs/DFF outputs)
+	vector<int> levelOrder;        // combo gate indices sorted by level
+	int levelCnt = 0;              // number of logic levels
+	int nodeCnt = 0;               // the number of Nodes
+	int compCnt = 0;               // the number of combo gates
+	int dffCnt = 0;                // the number of DFFs
+
+	// The constructor reads the passed netlist file. The netlist is loaded from its image when it has a current 
+	// one, and otherwise read from the netlist text, saving an image for the next time (see NETLIST IMAGES). With 
+	// images false, the netlist text is always read and no image is saved. 
+	Netlist(string z, bool images = true) {
+		// BEGIN READING NETLIST FILE (parsed in place, see TextScanner)
+		MappedFile MyReadFile(z);
+		string_view text = MyReadFile.Text();
+		uint64_t hash = FNV1a64(text);
+		bool useImage = images && !text.empty();
+		if (!useImage || !LoadImage(ImagePath(z), hash, text.size())) {
+			ReadText(text);
+			// Call the FindIOs function to determine which nodes are inputs/outputs to the netlist. 
+			FindIOs();
+			// Compile the netlist connections into the fanout tables used by the simulators. 
+			BuildFanout();
+			// Sort the combo gates into logic levels for the levelized simulators. 
+			levelized = Levelize();
+			if (useImage) {
+				SaveImage(ImagePath(z), hash, text.size());
+			}
+		}
+		file = z;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function reads the gates, DFFs and clocks of the passed netlist text. 
+	void ReadText(string_view text) {
+		list<string_view> ComboLogicOptions = {".OR", ".AND", ".XOR", ".NOR", ".NAND", ".XNOR"};
+
+		TextScanner netlistText(text);
+		while (netlistText.NextLine()) {
+			// The input netlist has the following format to be read:
+			// OUTPUT   .COMPONENT    (DELAYS)    INPUT1     INPUT2    ....
+			string_view out = netlistText.Token();      // 1 output
+			string_view compType = netlistText.Token(); // component type
+			int delay[2] = {0, 0}; // up to 2 delay parameters 
+
+			// ------------------------------
+			// skip comment lines (and blank lines)
+			if (out.empty()) {continue;} 
+
+			// ------------------------------
+			// process combinatorial logic unit
+			if (find(ComboLogicOptions.begin(), ComboLogicOptions.end(), compType) != ComboLogicOptions.end()) {
+				// Find or create output node for logic gate
+				int o = NodeIndex(out);
+
+				// read in rise and fall time for combo logic gate
+				ParseNumber(netlistText.Token(), delay[0]);
+				ParseNumber(netlistText.Token(), delay[1]);
+				// read in input(s) for combo logic gate (8 is max # of inputs for a Component)
+				int inputIdx[8];
+				int inputCnt = 0;
+				for (int i=0; i < 8; i++) {
+					string_view in = netlistText.Token();
+					if (!in.empty()) {
+						inputIdx[inputCnt++] = NodeIndex(in);
+					}
+				}
+
+				// Determine the type of Component being made and add it to the gate table. 
+				GateOp op = (compType == ".OR") ? OR_OP : (compType == ".AND") ? AND_OP : (compType == ".XOR") ? XOR_OP : 
+				            (compType == ".NOR") ? NOR_OP : (compType == ".NAND") ? NAND_OP : XNOR_OP;
+				gates.Add(op, delay[0], delay[1], o, inputIdx, inputCnt);
+				++compCnt;
+			}
+			// ------------------------------
+			// process sequential logic DFF unit
+			else if (compType.compare(".DFF") == 0) {
+				float setupTime = 0, holdTime = 0;
+				ParseNumber(netlistText.Token(), setupTime);
+				ParseNumber(netlistText.Token(), holdTime);
+				string_view D = netlistText.Token();
+				string_view CLK = netlistText.Token();
+				string_view Q = netlistText.Token();
+				string_view Qn = netlistText.Token();
+				int d = NodeIndex(D);
+				int clk = NodeIndex(CLK);
+				int q = NodeIndex(Q);
+				int qn = NodeIndex(Qn);
+				dffNodes.insert(dffNodes.end(), {d, clk, q, qn});
+				dffTimes.insert(dffTimes.end(), {setupTime, holdTime});
+				++dffCnt;
+			}
+			// ------------------------------
+			// process clock generator (its edges are generated while simulating, see ClockSource)
+			else if (compType.compare(".CLOCK") == 0) {
+				int period = 0, duty = 50, phase = 0, start = 0, stop = 0;
+				ParseNumber(netlistText.Token(), period);
+				ParseNumber(netlistText.Token(), duty);
+				ParseNumber(netlistText.Token(), phase);
+				ParseNumber(netlistText.Token(), start);
+				ParseNumber(netlistText.Token(), stop);
+				clockNodes.push_back(NodeIndex(out));
+				clocks.push_back(ClockSource(NULL, period, duty, phase, start, stop));
+			}
+		}
+	}
+
+	// This Function returns the index of the Node with the passed name, adding the Node if it is new. 
+	int NodeIndex(string_view nodeName) {
+		int idx = symbols.Intern(nodeName);
+		nodeCnt = symbols.Size();
+		return idx;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function runs to determine which nodes in the netlist are inputs and outputs (IOs). 
+	void FindIOs() {
+		// Count how many times each Node appears as an output/input of a component, indexed by the Node's 
+		// symbol table index. This takes a single pass over the components. 
+		vector<int> input_occurances(nodeCnt, 0);
+		vector<int> output_occurances(nodeCnt, 0);
+		for (int j=0; j<compCnt; j++) {
+			output_occurances[gates.out[j]] += 1;
+			for (int f = gates.inStart[j]; f < gates.inStart[j+1]; f++) {
+				input_occurances[gates.in[f]] += 1;
+			}
+		}
+
+		// Determine which Nodes are inputs/outputs to the netlist. 
+		for (int i=0; i < nodeCnt; i++) {
+			// If the Node never appeared as an output to a component then it is an input. 
+			if (output_occurances[i] == 0) {
+				inputs.push_back(i);
+			}
+			// If the Node never appeared as an input to a component then it is an output. 
+			if (input_occurances[i] == 0) {
+				outputs.push_back(i);
+			}
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function compiles the netlist connections into the fanout tables. A gate reading the same Node on more 
+	// than one input is only listed once for that Node. 
+	void BuildFanout() {
+		vector<pair<int,int>> gatePairs, clockPairs, dataPairs;
+		for (int k=0; k < compCnt; k++) {
+			for (int f = gates.inStart[k]; f < gates.inStart[k+1]; f++) {
+				bool repeated = false;
+				for (int j = gates.inStart[k]; j < f; j++) {
+					repeated = repeated || (gates.in[j] == gates.in[f]);
+				}
+				if (!repeated) {
+					gatePairs.push_back(make_pair(gates.in[f], k));
+				}
+			}
+		}
+		for (int k=0; k < dffCnt; k++) {
+			clockPairs.push_back(make_pair(dffNodes[4*k + 1], k));
+			dataPairs.push_back(make_pair(dffNodes[4*k], k));
+		}
+		gateFanout.Build(nodeCnt, gatePairs);
+		clockFanout.Build(nodeCnt, clockPairs);
+		dataFanout.Build(nodeCnt, dataPairs);
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function sorts the combo gates into logic levels. Nodes not driven by a combo Component (primary 
+	// inputs and DFF outputs) are level sources, so the DFFs split the netlist into combinational blocks. A gate's
+	// level is one more than the highest level among the gates driving its inputs. Gates with the same level keep
+	// their netlist order. Returns false if the combo Components contain a loop (the netlist cannot be levelized). 
+	bool Levelize() {
+		// find the gate driving each Node, and count the inputs of each gate driven by other gates
+		vector<int> driver(nodeCnt, -1);
+		for (int k=0; k < compCnt; k++) {
+			driver[gates.out[k]] = k;
+		}
+		vector<int> pending(compCnt, 0);
+		for (int n=0; n < nodeCnt; n++) {
+			if (driver[n] == -1) {
+				continue;
+			}
+			for (int f = gateFanout.Begin(n); f < gateFanout.End(n); f++) {
+				pending[gateFanout.Item(f)] += 1;
+			}
+		}
+
+		// Kahn's algorithm: a gate is levelized once all of its driving gates are
+		gateLevel.assign(compCnt, 0);
+		vector<int> ready;
+		for (int k=0; k < compCnt; k++) {
+			if (pending[k] == 0) {
+				ready.push_back(k);
+			}
+		}
+		for (size_t r = 0; r < ready.size(); r++) {
+			int k = ready[r];
+			int n = gates.out[k];
+			if (driver[n] != k) {
+				continue; // a Node driven by more than one gate only propagates from its last driver
+			}
+			for (int f = gateFanout.Begin(n); f < gateFanout.End(n); f++) {
+				int g = gateFanout.Item(f);
+				gateLevel[g] = max(gateLevel[g], gateLevel[k] + 1);
+				if (--pending[g] == 0) {
+					ready.push_back(g);
+				}
+			}
+		}
+		if ((int)ready.size() != compCnt) {
+			return false;
+		}
+
+		// bucket the gates by level (stable, so equal levels keep netlist order)
+		levelCnt = 0;
+		for (int k=0; k < compCnt; k++) {
+			levelCnt = max(levelCnt, gateLevel[k] + 1);
+		}
+		vector<pair<int,int>> byLevel;
+		for (int k=0; k < compCnt; k++) {
+			byLevel.push_back(make_pair(gateLevel[k], k));
+		}
+		FanoutTable levels;
+		levels.Build(levelCnt, byLevel);
+		levelOrder.clear();
+		for (int f = 0; f < compCnt; f++) {
+			levelOrder.push_back(levels.Item(f));
+		}
+		return true;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function returns the path of the image of the passed netlist file (see NETLIST IMAGES). 
+	static string ImagePath(const string& file) {
+		return file + ".dsimg";
+	}
+
+	// This Function saves the Netlist, just read from netlist text with the passed hash and size, to an image file. 
+	// If the image cannot be written (e.g. the netlist is in a read-only directory) the netlist is just read again 
+	// next time. 
+	void SaveImage(const string& imageFile, uint64_t hash, uint64_t size) const {
+		ImageWriter image(imageFile, hash, size);
+		int counts[6] = {nodeCnt, compCnt, dffCnt, (int)clocks.size(), levelized, levelCnt};
+		image.Array(counts, 6);
+		symbols.Save(image);
+		gates.Save(image);
+		image.Array(dffNodes);
+		image.Array(dffTimes);
+		vector<int> clockFields; // Node, period, high time, first edge and stop time of each clock
+		for (size_t k = 0; k < clocks.size(); k++) {
+			const ClockSource& c = clocks[k];
+			clockFields.insert(clockFields.end(), {clockNodes[k], c.period, c.high, c.first, c.stop});
+		}
+		image.Array(clockFields);
+		gateFanout.Save(image);
+		clockFanout.Save(image);
+		dataFanout.Save(image);
+		image.Array(inputs);
+		image.Array(outputs);
+		image.Array(gateLevel);
+		image.Array(levelOrder);
+		image.Close();
+	}
+
+	// This Function loads the Netlist from an image file. The tables are copied straight out of the mapped image, 
+	// so nothing is tokenized, hashed or searched. Returns false, leaving the Netlist empty, if the file is missing, 
+	// is not a current image of netlist text with the passed hash and size, or is damaged. 
+	bool LoadImage(const string& imageFile, uint64_t hash, uint64_t size) {
+		MappedFile mapped(imageFile);
+		ImageReader image(mapped.Text());
+		size_t n;
+		const int* counts = image.Header(hash, size) ? image.Array<int>(n) : NULL;
+		if (counts == NULL || n != 6) {
+			return false;
+		}
+		int nodeTotal = counts[0], gateTotal = counts[1], dffTotal = counts[2], clockTotal = counts[3];
+		bool valid = symbols.Load(image) && symbols.Size() == nodeTotal && gates.Load(image, nodeTotal) && 
+		             gates.Size() == gateTotal;
+		size_t clockFieldCnt;
+		image.Array(dffNodes);
+		image.Array(dffTimes);
+		const int* clockFields = image.Array<int>(clockFieldCnt);
+		valid = valid && gateFanout.Load(image, nodeTotal, gateTotal) && clockFanout.Load(image, nodeTotal, dffTotal) && 
+		        dataFanout.Load(image, nodeTotal, dffTotal);
+		image.Array(inputs);
+		image.Array(outputs);
+		image.Array(gateLevel);
+		image.Array(levelOrder);
+		valid = valid && image.Ok() && dffNodes.size() == 4*(size_t)dffTotal && dffTimes.size() == 2*(size_t)dffTotal && 
+		        clockFieldCnt == 5*(size_t)clockTotal && gateLevel.size() == (size_t)gateTotal && 
+		        levelOrder.size() == ((counts[4]) ? (size_t)gateTotal : 0);
+		// every Node index read must name a Node, and the level order must list gates
+		auto inRange = [](const int* items, size_t count, size_t step, int limit) {
+			for (size_t i = 0; i < count; i += step) {
+				if (items[i] < 0 || items[i] >= limit) {
+					return false;
+				}
+			}
+			return true;
+		};
+		valid = valid && inRange(dffNodes.data(), dffNodes.size(), 1, nodeTotal) && 
+		        inRange(clockFields, clockFieldCnt, 5, nodeTotal) && inRange(inputs.data(), inputs.size(), 1, nodeTotal) && 
+		        inRange(outputs.data(), outputs.size(), 1, nodeTotal) && 
+		        inRange(levelOrder.data(), levelOrder.size(), 1, gateTotal);
+		if (!valid) {
+			*this = Netlist();
+			return false;
+		}
+
+		for (int k=0; k < clockTotal; k++) {
+			const int* c = clockFields + 5*k;
+			ClockSource clock(NULL, c[1], 50, 0, 0, c[4]);
+			clock.high = c[2];
+			clock.first = c[3];
+			clockNodes.push_back(c[0]);
+			clocks.push_back(clock);
+		}
+		nodeCnt = nodeTotal;
+		compCnt = gateTotal;
+		dffCnt = dffTotal;
+		levelized = (counts[4] != 0);
+		levelCnt = counts[5];
+		return true;
+	}
+
+private:
+	// An empty Netlist (see LoadImage). 
+	Netlist() {}
+};
+
+// ------------------------------------------------------------------------------------------------------------------
+// --------------------------------------------------- CIRCUIT ------------------------------------------------------
+// ------------------------------------------------------------------------------------------------------------------
+// This very important class (VIC) implements the circuit object used by both simulator types as well as the fault 
+// vector generator. A circuit objects is responsible for establishing all top level connections between Nodes, 
+// Components, as well as inputs/outputs to the circuit. These top level connections are defined by the netlist 
+// fed into the program at the start. A Circuit object also contains the functions which define the operation 
+// of the system. That is, we define below functions for running Timing Simulations, Functional Simulations, and
+// Fault Vector Generation on a Circuit object. 
+//
+// The simulators run on packed tables built from the netlist: the GateTable for the combo gates and the values 
+// array for the Nodes. The Node and DFF objects describe the same Circuit for the rest of the program and are kept 
+// up to date by the simulators (see LoadValues); no combo Component objects are made for a Circuit. 
+//
+// The tables that only describe the netlist belong to a Netlist shared by every Circuit made from it. A Circuit owns
+// the state a simulation changes: the Node values and stuck-at flags, the gate outputs (GateState) and the DFFs. 
+// That state can be saved and restored as a CircuitState, so one Circuit can stand in for many fault machines (see
+// FaultVectorGenerator). 
+
+// Functional Simulation engines selectable from the command line (see main). 
+enum FunctionalEngine { EVENT_ENGINE, LEVELIZED_ENGINE, COMPILED_ENGINE, CYCLE_ENGINE };
+
+// Timing Simulation engines selectable from the command line (see main). 
+
+// The state of a Circuit changed by simulating it (see Circuit::SaveState). An empty state stands for the state of 
+// a new Circuit. 
+struct CircuitState {
+	vector<uint8_t> values;    // value (LogicValue) of each Node
+	vector<uint8_t> stuck;     // 1 if the Node is stuck-at
+	vector<uint8_t> gateValue; // current output of each gate (see GateState)
+	vector<DFF::State> dffs;   // state of each DFF
+};
+
+class Circuit {
+private:
+	// Circuit objects contain the following private attributes:
+	shared_ptr<const Netlist> net; // the netlist structure, shared with the other Circuits made from it (see Netlist)
+	string netlist = net->file;    // user-input netlist detailing top-level circuit connections
+	string timingOutput = "TimingSimOutput.vcd";         // waveform file written by the Timing Simulations
+	string functionalOutput = "FunctionalSimOutput.vcd"; // waveform file written by the Functional Simulations
+	vector<DFF> dffStore;          // the sequential DFF objects
+	vector<DFF*> dffs;             // pointers to the DFF objects
+	vector<ClockSource> clocks;    // clock generators driving Nodes (see ClockSource)
+	long long clockSeq = 0;        // sequence number of the first clock's edges (see AppendClockEdge)
+	vector<Node> nodeStore;        // all Node objects, indexed by symbol table index
+	set<Node*> outputnodes;        // set of pointers to output Node objects
+	set<Node*> inputnodes;		   // set of pointers to input Node objects
+	vector<Node*> nodeList;        // pointers to all Node objects indexed by symbol table index
+	const SymbolTable& symbols = net->symbols;        // name-to-index table for all Node names
+	const FanoutTable& gateFanout = net->gateFanout;  // Node index -> indices of combo Components reading the Node
+	const FanoutTable& clockFanout = net->clockFanout; // Node index -> indices of DFFs clocked by the Node
+	const FanoutTable& dataFanout = net->dataFanout;  // Node index -> indices of DFFs with the Node on their D input
+	const GateTable& gates = net->gates;              // the combo Components packed for the simulators (see GateTable)
+	GateState gateState;           // output values of the combo Components
+	vector<uint8_t> values;        // current value (LogicValue) of each Node by index, used by the simulators
+	vector<uint8_t> stuck;         // 1 if the Node is stuck-at (see LoadValues)
+	bool levelized = net->levelized;                  // true if the combo Components form no loops (see Levelize)
+	const vector<int>& gateLevel = net->gateLevel;    // logic level of each combo Component
+	const vector<int>& levelOrder = net->levelOrder;  // combo Component indices sorted by level
+	int levelCnt = net->levelCnt;                     // number of logic levels
+	PatternProgram patternProgram; // the gates flattened for the pattern kernels (see BuildPatternProgram)
+	FanoutTable patternDrivers;    // Node index -> positions in the pattern program of the gates driving the Node
+	bool patternProgramReady = false;
+	PatternKernel patternKernel = DetectPatternKernel(); // kernel used by SimulatePatterns
+	NativeModule native;           // compiled module of the netlist (see FunctionalSimulationCompiled)
+	EventQueue queue;              // the Event Queue for the Circuit
+	double waveformStall = 0;      // seconds the last simulation waited for the waveform writer thread (see VCDWriter)
+	WaveformOptions waveformOptions; // how the simulations write their waveforms (see SetWaveformOptions)
+	vector<char> dumpMask;         // Nodes dumped to waveforms (see DumpMask)
+	bool dumpMaskReady = false;
+  
+	int compCnt = net->compCnt;	   // the number of combo Components in the Circuit
+	int dffCnt = net->dffCnt;      // the number of DFFs in the Circuit
+	int nodeCnt = net->nodeCnt;	   // the number of Nodes in the Circuit
+public:
+	// The constructor for the Circuit object is passed a string netlist file. The constructor reads the netlist 
+	// (see Netlist, which loads and saves netlist images unless images is false) and creates the Circuit based on it. 
+	Circuit(string z, bool images = true) : Circuit(make_shared<const Netlist>(z, images)) {
+		cout << "Circuit Netlist Mapped" << endl;
+	}
+
+	// This constructor creates a Circuit on a netlist already read, sharing its tables with the other Circuits made 
+	// from it. Only the Node and DFF objects and the simulation state are created, all at their initial values, each 
+	// kind in one array. The combo Components are only the netlist's GateTable, with their outputs in gateState. 
+	Circuit(shared_ptr<const Netlist> n) : net(n) {
+		nodeStore.reserve(nodeCnt);
+		nodeList.reserve(nodeCnt);
+		for (int i=0; i < nodeCnt; i++) {
+			nodeStore.emplace_back(string(symbols.Name(i)), i);
+			nodeList.push_back(&nodeStore.back());
+		}
+		dffStore.reserve(dffCnt);
+		for (int k=0; k < dffCnt; k++) {
+			const int* d = net->dffNodes.data() + 4*k;
+			dffStore.emplace_back(nodeList[d[0]], nodeList[d[1]], nodeList[d[2]], nodeList[d[3]], net->dffTimes[2*k], 
+			                      net->dffTimes[2*k + 1]);
+			dffs.push_back(&dffStore.back());
+		}
+		clocks = net->clocks;
+		for (size_t k=0; k < clocks.size(); k++) {
+			clocks[k].node = nodeList[net->clockNodes[k]];
+		}
+		for (int i : net->inputs) {
+			inputnodes.insert(nodeList[i]);
+		}
+		for (int i : net->outputs) {
+			outputnodes.insert(nodeList[i]);
+		}
+		gateState.Attach(gates);
+		values.assign(nodeCnt, ZERO);
+		stuck.assign(nodeCnt, 0);
+	}
+	// nodeList and the DFFs point into nodeStore, so a Circuit cannot be copied
+	Circuit(const Circuit&) = delete;
+	Circuit& operator=(const Circuit&) = delete;
+
+	// This Function returns the netlist of the Circuit, to create more Circuits on it. 
+	shared_ptr<const Netlist> SharedNetlist() const {
+		return net;
+	}
+
+	// This Function sets the waveform files written by the Timing and Functional Simulations of the Circuit (by 
+	// default TimingSimOutput.vcd and FunctionalSimOutput.vcd), so Circuits simulated at the same time do not 
+	// write the same file. 
+	void SetOutputFiles(string timingVCD, string functionalVCD) {
+		timingOutput = timingVCD;
+		functionalOutput = functionalVCD;
+	}
+
+	// This Function sets how the Timing and Functional Simulations of the Circuit write their waveforms: on a writer 
+	// thread, compressed, limited to some Nodes and times, or with a waveform database (see WaveformOptions). By 
+	// default every Node is dumped to a VCD written on the simulator thread. 
+	void SetWaveformOptions(const WaveformOptions& options) {
+		waveformOptions = options;
+		dumpMaskReady = false;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// Helper function to look up an existing node by name through the symbol table. 
+	// Returns NULL if no node with that name exists in the circuit. 
+	Node* FindNode(string_view nodeName) {
+		int idx = symbols.Find(nodeName);
+		return (idx < 0) ? NULL : nodeList[idx];
+	}
+
+	// This Function returns FindNode() as the Node lookup of stimulus readers (see StimulusStream). 
+	function<Node*(string_view)> NodeLookup() {
+		return [this](string_view nodeName) { return FindNode(nodeName); };
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// The simulators keep Node values in the values array. The Node objects stay the public view of the Circuit: 
+	// LoadValues copies their values and stuck-at flags into the arrays at the start of a simulation, and SetValue 
+	// writes every change through to the Node object, so the Nodes always match the arrays. 
+	void LoadValues() {
+		for (int n=0; n < nodeCnt; n++) {
+			values[n] = nodeList[n]->CurValue;
+			stuck[n] = (nodeList[n]->StuckAtOp != 0);
+		}
+	}
+
+	// This Function sets the value of Node n, unless the Node is stuck-at (see Node::UpdateValue). 
+	void SetValue(int n, LogicValue value) {
+		if (!stuck[n]) {
+			values[n] = value;
+			nodeList[n]->CurValue = value;
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function returns the simulation state of the Circuit: its Node values and stuck-at flags, gate outputs 
+	// and DFF states. 
+	CircuitState SaveState() {
+		CircuitState state;
+		LoadValues();
+		state.values = values;
+		state.stuck = stuck;
+		state.gateValue = gateState.value;
+		for (int k=0; k < dffCnt; k++) {
+			state.dffs.push_back(dffs[k]->Save());
+		}
+		return state;
+	}
+
+	// This Function restores a state returned by SaveState (on this Circuit or another Circuit made from the same 
+	// Netlist), or the initial state of the Circuit if the passed state is empty. If keepStuck is true, the stuck-at 
+	// Nodes of the Circuit stay stuck-at at their stuck value (see Reset). 
+	void RestoreState(const CircuitState& state, bool keepStuck = false) {
+		bool initial = state.values.empty();
+		for (int n=0; n < nodeCnt; n++) {
+			Node* node = nodeList[n];
+			int wasStuck = node->StuckAtOp;
+			node->pendingEvents = 0;
+			if (keepStuck && wasStuck) {
+				continue;
+			}
+			node->CurValue = initial ? ZERO : (LogicValue)state.values[n];
+			node->StuckAtOp = initial ? 0 : state.stuck[n];
+			if (node->StuckAtOp != wasStuck) {
+				PatchPatternDrivers(n);
+			}
+		}
+		LoadValues();
+		if (initial) {
+			gateState.Attach(gates);
+		}
+		else {
+			gateState.value = state.gateValue;
+		}
+		for (int k=0; k < dffCnt; k++) {
+			dffs[k]->Restore(initial ? DFF::State{false, ZERO, ZERO, 0, 0} : state.dffs[k]);
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function schedules the fanout of a Node that changed at the passed time. It is shared by all simulators. 
+	// simType is passed on to the DFF timers (0 = functional sim, 1 = timing sim which reports violations). 
+	void ScheduleFanout(Node* node, int time, int simType) {
+		int n = node->index;
+		// Add all components connected to the changing Node to the Event queue
+		//
+		// We check if this input node change is expected to change the output of any gate its connected to. 
+		// If it will, then we cancel the all pending gate changes already in queue, revert the gate, and add the gate
+		// change to the event queue. 
+		//
+		// If the input node change will not change the output of an already pending gate change event then it overrides 
+		// this event and we do nothing.  
+		for (int f = gateFanout.Begin(n); f < gateFanout.End(n); f++) {
+			int g = gateFanout.Item(f);
+			if (gateState.PreCalc(g, values.data())) {
+				if (queue.Delete(nodeList[gates.out[g]])) {
+					gateState.Revert(g, values.data());
+				}
+				queue.Append(Event(g, NULL, time, Z, GATE_EVENT));
+			}
+		}
+		// Now, if any DFFs use this Node as a clock then we must add the DFF to Event Queue to update
+		// its output values Q, Qn.
+		for (int f = clockFanout.Begin(n); f < clockFanout.End(n); f++) {
+			queue.Append(Event(clockFanout.Item(f), NULL, time, Z, DFF_EVENT));
+		}
+		// Additionally, if this Node is a D input to a DFF, we must start timers to check for setup
+		// and hold time violations.
+		for (int f = dataFanout.Begin(n); f < dataFanout.End(n); f++) {
+			dffs[dataFanout.Item(f)]->ErrTimersD(time, simType);
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function appends edge i of clock k to the Event Queue, unless the clock stops before it. The Event's 
+	// eventComp holds k, so the simulators append the clock's next edge when the Event executes. The edges take the 
+	// sequence numbers reserved after the stimulus (clockSeq), so they execute exactly as if every edge had been 
+	// listed at the end of the stimulus file. 
+	void AppendClockEdge(int k, long long i) {
+		int time = clocks[k].EdgeTime(i);
+		if (time >= 0) {
+			queue.Append(Event(k, clocks[k].node, time, clocks[k].EdgeValue(i), NODE_EVENT), clockSeq + k);
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function selects the scheduler used by the Circuit's Event Queue (see SchedulerType). A timing wheel is 
+	// sized to span the longest gate delay in the netlist, so every gate output Event lands directly on the wheel. 
+	void SetScheduler(SchedulerType type) {
+		int span = 1;
+		for (int i=0; i < compCnt; i++) {
+			span = max(span, gates.MaxDelay(i) + 1);
+		}
+		queue.SetScheduler(type, span);
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function returns the number of Events executed by the Circuit's simulations so far. 
+	long long EventsExecuted() {
+		return queue.Executed();
+	}
+
+	// This Function returns which Nodes are dumped to waveforms, by Node index: those matching a --dump pattern or 
+	// --dump-regex (see WaveformOptions::dumpPatterns), or every Node (an empty mask) if none were given. The scope 
+	// patterns @inputs, @outputs and @dffs select the input Nodes, the output Nodes and the DFF Q/Qn Nodes. 
+	const vector<char>& DumpMask() {
+		if (dumpMaskReady) {
+			return dumpMask;
+		}
+		dumpMaskReady = true;
+		dumpMask.clear();
+		if (waveformOptions.dumpPatterns.empty() && waveformOptions.dumpRegexes.empty()) {
+			return dumpMask;
+		}
+		dumpMask.assign(nodeCnt, 0);
+		vector<regex> regexes;
+		for (const string& expression : waveformOptions.dumpRegexes) {
+			regexes.push_back(regex(expression));
+		}
+		for (const string& pattern : waveformOptions.dumpPatterns) {
+			if (pattern == "@inputs" || pattern == "@outputs") {
+				for (int n : (pattern == "@inputs") ? net->inputs : net->outputs) {
+					dumpMask[n] = 1;
+				}
+			}
+			else if (pattern == "@dffs") {
+				for (int k = 0; k < dffCnt; k++) {
+					dumpMask[net->dffNodes[4*k + 2]] = 1;
+					dumpMask[net->dffNodes[4*k + 3]] = 1;
+				}
+			}
+		}
+		for (int n = 0; n < nodeCnt; n++) {
+			string_view name = symbols.Name(n);
+			for (size_t k = 0; !dumpMask[n] && k < waveformOptions.dumpPatterns.size(); k++) {
+				const string& pattern = waveformOptions.dumpPatterns[k];
+				dumpMask[n] = pattern[0] != '@' && GlobMatch(pattern, name);
+			}
+			for (size_t k = 0; !dumpMask[n] && k < regexes.size(); k++) {
+				dumpMask[n] = regex_match(name.begin(), name.end(), regexes[k]);
+			}
+		}
+		return dumpMask;
+	}
+
+	// This Function opens the waveform of a simulation of the input file z with the Circuit's waveform options, 
+	// limited to the dumped Nodes (see DumpMask) and to the dump windows and the $dumpon/$dumpoff lines of the input 
+	// file (see VCDWriter::Select). 
+	void OpenWaveform(VCDWriter& VCDFile, const string& file, const string& version, const string& z) {
+		VCDFile.SetOptions(waveformOptions);
+		VCDFile.Select(DumpMask(), ReadDumpMarks(z));
+		VCDFile.Open(file, version, nodeList);
+	}
+
+	// This Function returns the time the last simulation waited for its waveform writer thread (see VCDWriter). 
+	double WaveformStall() {
+		return waveformStall;
+	}
+
+	// This Function returns the largest number of Events the Circuit's Event Queue has held at once so far. 
+	long long QueuePeak() {
+		return queue.Peak();
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// --------------------------------------------- TIMING SIMULATION --------------------------------------------------
+	// This Function runs a Timing Simulation on the Circuit. It takes in as an argument the input file as a string.
+	// The Timing Simulator uses an Event Queuing system to determine the order of Events to execute wherein Events 
+	// are queued by realistic execution times based on their associated delays.  
+	void TimingSimulation(string z) {
+		cout << "Starting Timing Simulation..." << endl;
+
+		VCDWriter VCDFile;
+		OpenWaveform(VCDFile, timingOutput, "DigiSim Timing Simulator", z);
+		VCDFile.DumpVars(nodeList);
+
+
+		// first see if any components are expected to change output logic value based on initial state.
+		// if so.. add to queue. 
+		// if we have any NAND, NOR, XNOR gates start by sending these to the event queue at time 0
+		LoadValues();
+		for (int i=0; i < compCnt; i++) {
+		    // calculate all gate outputs at time 0
+			int delay = gateState.Calculate(i, values.data());
+
+			// if output of a gate will change (delay != 0) at time 0, add it to queue
+			if (delay != 0) {
+				queue.Append(Event(-1, nodeList[gates.out[i]], delay, gateState.Output(i), NODE_EVENT));
+			}
+		}
+
+		// also want to update inverse output value of DFFs at time 0 to be 1..
+		// no need to update Q output since it will remain 0. (no clock edge at time 0 possible)
+		// for (int i=0; i < dffCnt; i++) {
+		// 	dffs[i]->Calculate();
+		// 	queue.Append(Event(NULL, dffs[i]->Qn, 0, dffs[i]->ReadQn(), 1));
+		// }
+
+		// Merge the user defined inputs into the event queue (changes at equal times keep their order in the file)
+		StimulusStream stimulus(z, NodeLookup());
+		queue.Attach(&stimulus);
+		// and the first edge of each clock
+		clockSeq = queue.Reserve(clocks.size());
+		for (size_t k = 0; k < clocks.size(); k++) {
+			AppendClockEdge(k, 0);
+		}
+
+
+		// start executing event queue for this circuit
+		while (!queue.Empty()) {
+			Event nextEvent = queue.Top();
+
+			// if next in Event Queue is a Node then we update the node value and write the change to the output file. 
+			if (nextEvent.CompNode == NODE_EVENT) {
+				SetValue(nextEvent.eventNode->index, nextEvent.nextVal);
+			
+
+				// *****  Write to the output file the change. ***** 
+        		// Write to VCD file
+		        VCDFile.Write(nextEvent.eventNode->index, nextEvent.nextVal, nextEvent.eventTime);
+
+
+				// Additionally, schedule every gate/DFF that reads this Node (see ScheduleFanout). 
+				ScheduleFanout(nextEvent.eventNode, nextEvent.eventTime, 1);
+				// and the next edge of a clock
+				if (nextEvent.eventComp >= 0) {
+					AppendClockEdge(nextEvent.eventComp, clocks[nextEvent.eventComp].EdgeAfter(nextEvent.eventTime));
+				}
+			}
+			// if next in Event Queue is a Component then calculate Component and compute delay
+			// Only apply delay for combinational gates for now..
+			// 
+			// when a gate changes output state, add the output wire node to queue to update
+			// after delay completes
+			else if (nextEvent.CompNode == GATE_EVENT) {
+				int g = nextEvent.eventComp;
+				int delay = gateState.Calculate(g, values.data()); // if delay is none zero, output of gate changed 
+				if (delay != 0) {
+					queue.Append(Event(-1, nodeList[gates.out[g]], nextEvent.eventTime + delay, 
+					                   gateState.Output(g), NODE_EVENT));
+				}
+			}
+			// DFFs have no delay at the moment.
+			else if (nextEvent.CompNode == DFF_EVENT) {
+				DFF* dff = dffs[nextEvent.eventComp];
+				dff->Calculate(nextEvent.eventTime, 1); // Calculate gate change
+				queue.Append(Event(-1, dff->Q, nextEvent.eventTime, dff->ReadQ(), NODE_EVENT));
+				queue.Append(Event(-1, dff->Qn, nextEvent.eventTime, dff->ReadQn(), NODE_EVENT));
+			}
+			queue.Pop();
+		}
+		queue.Attach(NULL);
+
+		VCDFile.Close();
+		waveformStall = VCDFile.StallSeconds();
+
+		// Output completion message
+		cout << "Timing Simulation Complete, waveform stored in " << VCDFile.OutputFile(timingOutput) << endl;
+	}
+
+	// -------------------------------------------- FUNCTIONAL SIMULATION --------------------------------------------------
+	// This Function runs a Functional Simulation on the Circuit. It takes in as an argument the input file as a string. 
+	// Like the Timing Simulation, the Functional Simulation also uses an Event Queueing system but this time, all
+	// Events originating off a changing input will happen at the same time. i.e. there is 0 delay for all Component updates. 
+	void FunctionalSimulation(string z) {
+		VCDWriter VCDFile;
+		OpenWaveform(VCDFile, functionalOutput, "DigiSim Functional Simulator", z);
+
+	    // calculate initial state of circuit amid NAND/NOR/XNOR logic
+	    LoadValues();
+	    FuncInit(); // initialize functional sim
+
+		// done calculating initial state
+		// output initial node values at time 0, not all 0
+		VCDFile.DumpVars(nodeList);
+
+		// Finished calculating initial state. Begin Functional Simulation:
+		// Merge the user defined inputs into the event queue
+		StimulusStream stimulus(z, NodeLookup());
+		queue.Attach(&stimulus);
+		clockSeq = queue.Reserve(clocks.size());
+		for (size_t k = 0; k < clocks.size(); k++) {
+			AppendClockEdge(k, 0);
+		}
+
+
+		// start executing event queue for this circuit
+		while (!queue.Empty()) {
+			Event nextEvent = queue.Top();
+
+			// if next in Event Queue is a Node then we update the node value and write the change to the output file. 
+			if (nextEvent.CompNode == NODE_EVENT) {
+				SetValue(nextEvent.eventNode->index, nextEvent.nextVal);
+			
+
+				// *****  Write to the output file the change. ***** 
+				VCDFile.Change(nextEvent.eventNode, nextEvent.eventTime);
+
+				// Additionally, schedule every gate/DFF that reads this Node (see ScheduleFanout). 
+				ScheduleFanout(nextEvent.eventNode, nextEvent.eventTime, 0);
+				// and the next edge of a clock
+				if (nextEvent.eventComp >= 0) {
+					AppendClockEdge(nextEvent.eventComp, clocks[nextEvent.eventComp].EdgeAfter(nextEvent.eventTime));
+				}
+			}
+			// if next in Event Queue is a Component then calculate Component and compute delay
+			// Only apply delay for combinational gates for now..
+			// 
+			// when a gate changes output state, add the output wire node to queue to update
+			// after delay completes
+			else if (nextEvent.CompNode == GATE_EVENT) {
+				int g = nextEvent.eventComp;
+				int delay = gateState.Calculate(g, values.data()); // if delay is none zero, output of gate changed 
+				if (delay != 0) {
+					queue.Append(Event(-1, nodeList[gates.out[g]], nextEvent.eventTime, gateState.Output(g), NODE_EVENT));
+				}
+			}
+			// DFFs have no delay at the moment.
+			else if (nextEvent.CompNode == DFF_EVENT) {
+				DFF* dff = dffs[nextEvent.eventComp];
+				dff->Calculate(nextEvent.eventTime, 0); // Calculate gate change
+				queue.Append(Event(-1, dff->Q, nextEvent.eventTime, dff->ReadQ(), NODE_EVENT));
+				queue.Append(Event(-1, dff->Qn, nextEvent.eventTime, dff->ReadQn(), NODE_EVENT));
+			}
+			queue.Pop();
+		}
+		queue.Attach(NULL);
+
+		VCDFile.Close();
+		waveformStall = VCDFile.StallSeconds();
+	}
+
+	void FuncInit() {
+		// Calculate initial state: start by processing any NAND, NOR, or XNOR gates
+		//
+		//
+		// send any NAND, NOR, XNOR gates to the event queue at time 0
+		for (int i=0; i < compCnt; i++) {
+			int delay = gateState.Calculate(i, values.data());
+
+			if (delay != 0) {
+				queue.Append(Event(-1, nodeList[gates.out[i]], 0, gateState.Output(i), NODE_EVENT));
+			}
+		}
+
+		// Process all of the NAND, NOR, XNOR gates in queue. 
+		while (!queue.Empty()) {
+			Event nextEvent = queue.Top();
+
+			// if next in Event Queue is a Node then we update the node value and write the change to the output file. 
+			if (nextEvent.CompNode == NODE_EVENT) {
+				SetValue(nextEvent.eventNode->index, nextEvent.nextVal);
+
+
+				// Additionally, schedule every gate/DFF that reads this Node (see ScheduleFanout). 
+				ScheduleFanout(nextEvent.eventNode, nextEvent.eventTime, 0);
+			}
+			// if next in Event Queue is a Component then calculate Component and compute delay
+			// Only apply delay for combinational gates for now..
+			// 
+			// when a gate changes output state, add the output wire node to queue to update
+			// after delay completes
+			else if (nextEvent.CompNode == GATE_EVENT) {
+				int g = nextEvent.eventComp;
+				int delay = gateState.Calculate(g, values.data()); // if delay is none zero, output of gate changed 
+				if (delay != 0) {
+					queue.Append(Event(-1, nodeList[gates.out[g]], nextEvent.eventTime, gateState.Output(g), NODE_EVENT));
+				}
+			}
+			// DFFs have no delay at the moment.
+			else if (nextEvent.CompNode == DFF_EVENT) {
+				DFF* dff = dffs[nextEvent.eventComp];
+				dff->Calculate(nextEvent.eventTime); // Calculate gate change
+				queue.Append(Event(-1, dff->Q, nextEvent.eventTime, dff->ReadQ(), NODE_EVENT));
+				queue.Append(Event(-1, dff->Qn, nextEvent.eventTime, dff->ReadQn(), NODE_EVENT));
+			}
+			queue.Pop();
+		}
+	}
+
+	// ------------------------------------------ LEVELIZED FUNCTIONAL SIMULATION ---------------------------------------
+	// This Function runs a Functional Simulation on the Circuit without the Event Queue. It takes in as an argument 
+	// the input file as a string and writes the same FunctionalSimOutput.vcd as FunctionalSimulation(). 
+	//
+	// The combo Components are evaluated in level order (see Levelize). At each stimulus time the input changes are 
+	// applied, DFFs clocked by a changed Node latch their D input (all DFFs latch before any Q output changes, like 
+	// the event-driven simulation), and then only the gates reading a changed Node are evaluated, lowest level first. 
+	// Since a gate's inputs are all settled before its level is reached, each gate is evaluated at most once per 
+	// time step. Netlists with combinational loops fall back to the event-driven FunctionalSimulation(). 
+	void FunctionalSimulationLevelized(string z) {
+		if (!levelized) {
+			cout << "Netlist contains combinational loops, running event-driven Functional Simulation" << endl;
+			FunctionalSimulation(z);
+			return;
+		}
+		StimulusCursor stimulus(z, NodeLookup(), clocks);
+		LoadValues();
+		VCDWriter VCDFile;
+		OpenWaveform(VCDFile, functionalOutput, "DigiSim Functional Simulator", z);
+
+		// calculate initial state of circuit amid NAND/NOR/XNOR logic: evaluate every gate once
+		LevelizedState state;
+		StartLevelized(state, false);
+		SettleLevelized(state, 0, VCDFile);
+		VCDFile.DumpVars(nodeList);
+
+		// Begin Functional Simulation: apply the stimulus (and clock edges) one time step at a time
+		Node* node;
+		LogicValue value;
+		for (int time = stimulus.Time(); time >= 0; time = stimulus.Time()) {
+			while (stimulus.Next(time, node, value)) {
+				SetNodeLevelized(state, node, value, time, VCDFile);
+			}
+			SettleLevelized(state, time, VCDFile);
+		}
+
+		VCDFile.Close();
+		waveformStall = VCDFile.StallSeconds();
+	}
+
+	// Working state of the levelized and cycle-based simulations: gates waiting for evaluation (bucketed by level) 
+	// and DFFs whose clock Node changed in the current time step. The levelized simulation writes each Node change 
+	// to the VCD as it happens, the cycle-based simulation (trackChanges) lists the changed Nodes for its next dump. 
+	struct LevelizedState {
+		vector<vector<int>> dirty;
+		vector<char> isDirty;
+		vector<int> clocked;
+		vector<char> isClocked;
+		vector<int> latching; // DFFs latching in the current pass (swapped with clocked, keeps its capacity)
+		bool trackChanges = false;
+		vector<int> changed;  // Nodes changed since the last dump (see DumpCycle)
+		vector<char> isChanged;
+	};
+
+	// This Function sizes the working state of a levelized or cycle-based simulation for the Circuit and queues 
+	// every gate, so the first settle calculates the initial state of the circuit amid NAND/NOR/XNOR logic. 
+	void StartLevelized(LevelizedState& state, bool trackChanges) {
+		state.dirty.assign(levelCnt, vector<int>());
+		state.isDirty.assign(compCnt, 0);
+		state.isClocked.assign(dffCnt, 0);
+		state.trackChanges = trackChanges;
+		state.isChanged.assign(trackChanges ? nodeCnt : 0, 0);
+		for (int k : levelOrder) {
+			state.isDirty[k] = 1;
+			state.dirty[gateLevel[k]].push_back(k);
+		}
+	}
+
+	// This Function sets a Node to a new value in the levelized or cycle-based simulation. If the value changes, the 
+	// change is recorded (in the VCD, or in the changed list with trackChanges) and the gates and DFFs reading the 
+	// Node are queued for evaluation. 
+	void SetNodeLevelized(LevelizedState& state, Node* node, LogicValue value, int time, VCDWriter& VCDFile) {
+		int n = node->index;
+		uint8_t old = values[n];
+		SetValue(n, value);
+		if (values[n] == old) {
+			return;
+		}
+		if (!state.trackChanges) {
+			VCDFile.Change(node, time);
+		}
+		else if (!state.isChanged[n]) {
+			state.isChanged[n] = 1;
+			state.changed.push_back(n);
+		}
+		for (int f = gateFanout.Begin(n); f < gateFanout.End(n); f++) {
+			int k = gateFanout.Item(f);
+			if (!state.isDirty[k]) {
+				state.isDirty[k] = 1;
+				state.dirty[gateLevel[k]].push_back(k);
+			}
+		}
+		for (int f = clockFanout.Begin(n); f < clockFanout.End(n); f++) {
+			int k = clockFanout.Item(f);
+			if (!state.isClocked[k]) {
+				state.isClocked[k] = 1;
+				state.clocked.push_back(k);
+			}
+		}
+	}
+
+	// This Function latches the DFFs whose clock Node changed: all of them sample their D input before any Q/Qn 
+	// output changes. Returns true if one of them saw a rising clock edge. 
+	bool LatchLevelized(LevelizedState& state, int time, VCDWriter& VCDFile) {
+		bool edge = false;
+		state.latching.swap(state.clocked);
+		state.clocked.clear();
+		for (int k : state.latching) {
+			state.isClocked[k] = 0;
+			edge = edge || (!dffs[k]->lastClockState && values[dffs[k]->CLK->index] == ONE);
+			dffs[k]->Calculate(time, 0);
+		}
+		for (int k : state.latching) {
+			SetNodeLevelized(state, dffs[k]->Q, dffs[k]->ReadQ(), time, VCDFile);
+			SetNodeLevelized(state, dffs[k]->Qn, dffs[k]->ReadQn(), time, VCDFile);
+		}
+		return edge;
+	}
+
+	// This Function finishes a time step of the levelized simulation. Clocked DFFs latch first, then the dirty gates 
+	// are evaluated level by level. This repeats if a gate output clocks a DFF (derived clocks). 
+	void SettleLevelized(LevelizedState& state, int time, VCDWriter& VCDFile) {
+		do {
+			LatchLevelized(state, time, VCDFile);
+
+			// evaluate the dirty gates, lowest level first (a gate only dirties gates on higher levels)
+			for (int l = 0; l < levelCnt; l++) {
+				for (size_t i = 0; i < state.dirty[l].size(); i++) {
+					int g = state.dirty[l][i];
+					state.isDirty[g] = 0;
+					// like the event-driven simulation, only a gate output change with a delay updates the Node
+					if (gateState.Calculate(g, values.data()) != 0) {
+						SetNodeLevelized(state, nodeList[gates.out[g]], gateState.Output(g), time, VCDFile);
+					}
+				}
+				state.dirty[l].clear();
+			}
+		} while (!state.clocked.empty());
+	}
+
+	// ------------------------------------------ CYCLE-BASED FUNCTIONAL SIMULATION -------------------------------------
+	// This Function runs a cycle-based Functional Simulation on the Circuit. It takes in as an argument the input file 
+	// as a string and leaves the Nodes and DFFs in the same final state as FunctionalSimulationLevelized(). If 
+	// dumpCycles is true, FunctionalSimOutput.vcd is written with one time step per active clock edge (and one for 
+	// the end of the stimulus), holding the values the levelized simulation has at the end of that time step. 
+	//
+	// The clock nets are the Nodes clocking a DFF, and an active edge is a time step in which a clock net rises. 
+	// Input changes between active edges are only recorded (the gates reading them are marked dirty). At an active 
+	// edge the dirty gates are evaluated once in level order, so the DFFs see settled D inputs, then the edge's input 
+	// changes are applied and all DFFs on the edge latch at the same time. Their new outputs are settled together 
+	// with the inputs of the next cycle, so the combinational logic is evaluated once per active edge (twice when 
+	// dumping, since the waveform needs the values at the edge). Netlists with combinational loops, with clock nets 
+	// driven by a gate or a DFF (derived clocks), or with a zero gate delay run the levelized simulation instead: a 
+	// gate change with no delay never reaches its output Node, so those outputs depend on every intermediate 
+	// evaluation the cycle-based simulation skips. 
+	void FunctionalSimulationCycle(string z, bool dumpCycles) {
+		vector<char> isClock(nodeCnt, 0);
+		for (int k=0; k < dffCnt; k++) {
+			isClock[dffs[k]->CLK->index] = 1;
+		}
+		bool derivedClocks = false;
+		bool zeroDelay = false;
+		for (int k=0; k < compCnt; k++) {
+			derivedClocks = derivedClocks || isClock[gates.out[k]];
+			zeroDelay = zeroDelay || gates.rise[k] == 0 || gates.fall[k] == 0;
+		}
+		for (int k=0; k < dffCnt; k++) {
+			derivedClocks = derivedClocks || isClock[dffs[k]->Q->index] || isClock[dffs[k]->Qn->index];
+		}
+		if (!levelized || derivedClocks || zeroDelay) {
+			cout << "Netlist contains combinational loops, derived clocks or zero delays, running levelized Functional "
+			     << "Simulation" << endl;
+			FunctionalSimulationLevelized(z);
+			return;
+		}
+		StimulusCursor stimulus(z, NodeLookup(), clocks);
+		LoadValues();
+		VCDWriter VCDFile;
+
+		// calculate initial state of circuit amid NAND/NOR/XNOR logic: evaluate every gate once. No gate or DFF output 
+		// clocks a DFF here, so SettleLevelized only evaluates gates and the DFFs latch in the LatchLevelized below. 
+		LevelizedState state;
+		StartLevelized(state, true);
+		SettleLevelized(state, 0, VCDFile);
+		if (dumpCycles) {
+			OpenWaveform(VCDFile, functionalOutput, "DigiSim Functional Simulator", z);
+			VCDFile.DumpVars(nodeList);
+		}
+		DumpCycle(state, 0, VCDFile, false);
+
+		// Begin Functional Simulation: apply the stimulus (and clock edges) one time step at a time
+		long long cycleCnt = 0;
+		int time = 0;
+		vector<pair<int, LogicValue>> step; // this time step's input changes
+		Node* node;
+		LogicValue value;
+		while (stimulus.Time() >= 0) {
+			time = stimulus.Time();
+			step.clear();
+			bool rising = false; // a clock net may rise in this time step
+			while (stimulus.Next(time, node, value)) {
+				rising = rising || (isClock[node->index] && value == ONE && values[node->index] != ONE);
+				step.push_back(make_pair(node->index, value));
+			}
+			// the DFFs sample the logic settled before this time step's input changes (like the levelized simulation)
+			if (rising) {
+				SettleLevelized(state, time, VCDFile);
+			}
+			for (const pair<int, LogicValue>& change : step) {
+				SetNodeLevelized(state, nodeList[change.first], change.second, time, VCDFile);
+			}
+			if (LatchLevelized(state, time, VCDFile)) {
+				cycleCnt++;
+				if (dumpCycles) {
+					SettleLevelized(state, time, VCDFile);
+					DumpCycle(state, time, VCDFile, true);
+				}
+			}
+		}
+		SettleLevelized(state, time, VCDFile);
+		DumpCycle(state, time, VCDFile, dumpCycles);
+		if (dumpCycles) {
+			VCDFile.Close();
+			waveformStall = VCDFile.StallSeconds();
+		}
+		cout << "Cycle-based Functional Simulation Complete, " << cycleCnt << " active clock edges" << endl;
+	}
+
+	// This Function writes the Nodes changed since the last dump to the VCD at the passed time (if write is true) and 
+	// clears the changed list. 
+	void DumpCycle(LevelizedState& state, int time, VCDWriter& VCDFile, bool write) {
+		for (int n : state.changed) {
+			state.isChanged[n] = 0;
+			if (write) {
+				VCDFile.Change(nodeList[n], time);
+			}
+		}
+		state.changed.clear();
+	}
+
+	// ------------------------------------------ COMPILED FUNCTIONAL SIMULATION ----------------------------------------
+	// This Function runs a Functional Simulation on the Circuit using a compiled module of the netlist (see 
+	// GenerateNativeCode) and writes the same FunctionalSimOutput.vcd as FunctionalSimulationLevelized(). 
+	//
+	// The module settles a time step with straight-line code: every gate is one statement in level order, so there 
+	// are no op switches or input index lookups left at run time, and only the gates reading a changed Node are 
+	// evaluated. The first run on a netlist generates and compiles the module, later runs load it from the 
+	// cache (see NativeModule). Circuits with stuck-at Nodes, netlists with combinational loops, and platforms where 
+	// the module cannot be built run the levelized simulation instead. 
+	void FunctionalSimulationCompiled(string z) {
+		LoadValues();
+		if (!levelized || count(stuck.begin(), stuck.end(), 1) != 0 || !LoadNativeModule()) {
+			cout << "Cannot compile netlist, running levelized Functional Simulation" << endl;
+			FunctionalSimulationLevelized(z);
+			return;
+		}
+		StimulusCursor stimulus(z, NodeLookup(), clocks);
+		VCDWriter VCDFile;
+		OpenWaveform(VCDFile, functionalOutput, "DigiSim Functional Simulator", z);
+
+		// the DFF states are copied into the module's state and written back when the simulation ends
+		vector<uint8_t> dffState(4*dffCnt, 0);
+		for (int k = 0; k < dffCnt; k++) {
+			dffState[4*k + 1] = dffs[k]->lastClockState;
+			dffState[4*k + 2] = dffs[k]->outQ;
+			dffState[4*k + 3] = dffs[k]->outQn;
+		}
+		// every gate starts dirty: calculate initial state of circuit amid NAND/NOR/XNOR logic
+		vector<uint32_t> dirty((compCnt + 31) / 32, 0xffffffff);
+		vector<uint8_t> changed(nodeCnt, 0);
+		vector<int> changedList(nodeCnt);
+		NativeState state = {values.data(), gateState.value.data(), dffState.data(), dirty.data(), 
+		                     changed.data(), changedList.data(), 0};
+		native.settle(&state);
+		CommitNativeChanges(state, 0, VCDFile);
+		VCDFile.DumpVars(nodeList);
+
+		// Begin Functional Simulation: apply the stimulus (and clock edges) one time step at a time
+		Node* node;
+		LogicValue value;
+		for (int time = stimulus.Time(); time >= 0; time = stimulus.Time()) {
+			while (stimulus.Next(time, node, value)) {
+				native.set(&state, node->index, value);
+			}
+			native.settle(&state);
+			CommitNativeChanges(state, time, VCDFile);
+		}
+
+		for (int k = 0; k < dffCnt; k++) {
+			dffs[k]->lastClockState = dffState[4*k + 1];
+			dffs[k]->outQ = (LogicValue)dffState[4*k + 2];
+			dffs[k]->outQn = (LogicValue)dffState[4*k + 3];
+		}
+		VCDFile.Close();
+		waveformStall = VCDFile.StallSeconds();
+	}
+
+	// This Function copies the Nodes changed by a compiled module back to the Node objects, records them in the VCD 
+	// and clears the changed list. 
+	void CommitNativeChanges(NativeState& state, int time, VCDWriter& VCDFile) {
+		for (int i = 0; i < state.changedCnt; i++) {
+			int n = state.changedList[i];
+			state.changed[n] = 0;
+			nodeList[n]->CurValue = (LogicValue)values[n];
+			VCDFile.Change(nodeList[n], time);
+		}
+		state.changedCnt = 0;
+	}
+
+	// This Function returns the cache key of the Circuit's compiled module: the hash of the netlist file contents 
+	// and the generator version, in hex. 
+	string NativeKey() {
+		ifstream NetlistFile(netlist, ios::binary);
+		stringstream contents;
+		contents << NetlistFile.rdbuf() << "\n" << NATIVE_CODE_VERSION;
+		char key[17];
+		snprintf(key, sizeof(key), "%016llx", (unsigned long long)FNV1a64(contents.str()));
+		return key;
+	}
+
+	// This Function loads the compiled module of the Circuit, generating and compiling it if it is not cached. 
+	bool LoadNativeModule() {
+		if (native.settle != NULL) {
+			return true;
+		}
+		int shape[3] = {nodeCnt, compCnt, dffCnt};
+		return native.Load(NativeKey(), shape, [this](ostream& out) { GenerateNativeCode(out); });
+	}
+
+	// This Function writes an int array definition to the generated code (ending in a 0 so it is never empty). 
+	static void WriteNativeArray(ostream& out, const char* name, const vector<int>& items) {
+		out << "static const int " << name << "[] = {";
+		for (int item : items) {
+			out << item << ",";
+		}
+		out << "0};\n";
+	}
+
+	// This Function writes the C++ source of the Circuit's compiled module. The module exports digisim_shape (the 
+	// Node, gate and DFF counts it was generated for), digisim_set and digisim_settle (see NativeModule). The gates 
+	// are written in level order as one statement each. Only the gates marked dirty (a changed input) are evaluated: 
+	// every 32 gates share a dirty word and a switch on its lowest set bit. The gates are split into functions of 
+	// nativeChunk gates to keep compile times down. A gate output only updates its Node when it changes with a 
+	// non-zero delay, like SettleLevelized. 
+	void GenerateNativeCode(ostream& out) {
+		const int nativeChunk = 256;
+		out << "// DigiSim compiled netlist " << netlist << " (generator version " << NATIVE_CODE_VERSION << ")\n"
+		    << "#include <stdint.h>\n"
+		    << "struct NativeState { uint8_t* values; uint8_t* gateValues; uint8_t* dffState; uint32_t* dirty; "
+		    << "uint8_t* changed; int* changedList; int changedCnt; };\n"
+		    << "extern \"C\" const int digisim_shape[3] = {" << nodeCnt << ", " << compCnt << ", " << dffCnt << "};\n";
+
+		// DFF connections
+		vector<int> dffD, dffClk, dffQ, dffQn;
+		for (int k = 0; k < dffCnt; k++) {
+			dffD.push_back(dffs[k]->D->index);
+			dffClk.push_back(dffs[k]->CLK->index);
+			dffQ.push_back(dffs[k]->Q->index);
+			dffQn.push_back(dffs[k]->Qn->index);
+		}
+		WriteNativeArray(out, "dffD", dffD);
+		WriteNativeArray(out, "dffClk", dffClk);
+		WriteNativeArray(out, "dffQ", dffQ);
+		WriteNativeArray(out, "dffQn", dffQn);
+
+		// for every Node: the DFFs it clocks and the level order positions of the gates reading it (CSR, like 
+		// FanoutTable)
+		vector<int> position(compCnt);
+		for (int i = 0; i < compCnt; i++) {
+			position[levelOrder[i]] = i;
+		}
+		vector<int> clockStart = {0}, clockItem, gateStart = {0}, gateItem;
+		for (int n = 0; n < nodeCnt; n++) {
+			for (int f = clockFanout.Begin(n); f < clockFanout.End(n); f++) {
+				clockItem.push_back(clockFanout.Item(f));
+			}
+			clockStart.push_back(clockItem.size());
+			for (int f = gateFanout.Begin(n); f < gateFanout.End(n); f++) {
+				gateItem.push_back(position[gateFanout.Item(f)]);
+			}
+			gateStart.push_back(gateItem.size());
+		}
+		WriteNativeArray(out, "clockStart", clockStart);
+		WriteNativeArray(out, "clockItem", clockItem);
+		WriteNativeArray(out, "gateStart", gateStart);
+		WriteNativeArray(out, "gateItem", gateItem);
+
+		// set a Node, recording the change and marking the DFFs and gates reading it
+		out << "extern \"C\" __attribute__((noinline)) void digisim_set(NativeState* s, int n, uint8_t value) {\n"
+		    << "\tif (s->values[n] == value) return;\n"
+		    << "\ts->values[n] = value;\n"
+		    << "\tif (!s->changed[n]) { s->changed[n] = 1; s->changedList[s->changedCnt++] = n; }\n"
+		    << "\tfor (int f = clockStart[n]; f < clockStart[n+1]; f++) s->dffState[4*clockItem[f]] |= 1;\n"
+		    << "\tfor (int f = gateStart[n]; f < gateStart[n+1]; f++) {\n"
+		    << "\t\ts->dirty[gateItem[f] >> 5] |= 1u << (gateItem[f] & 31);\n"
+		    << "\t}\n"
+		    << "}\n";
+
+		// the gates, in level order: each dirty word is drained lowest bit (lowest level) first, and a gate marking a 
+		// later gate of the same word dirty is picked up by the same loop
+		const char* opSymbols[6] = {" & ", " | ", " ^ ", " & ", " | ", " ^ "};
+		int chunkCnt = (compCnt + nativeChunk - 1) / nativeChunk;
+		for (int c = 0; c < chunkCnt; c++) {
+			out << "static void gates" << c << "(NativeState* s) {\n"
+			    << "\tconst uint8_t* v = s->values;\n\tuint8_t* g = s->gateValues;\n\tuint32_t* d = s->dirty;\n\tint n;\n";
+			for (int i = c*nativeChunk; i < min(compCnt, (c + 1)*nativeChunk); i++) {
+				int k = levelOrder[i];
+				if (i % 32 == 0) {
+					out << ((i > c*nativeChunk) ? "\t\t}\n\t}\n" : "") 
+					    << "\tfor (uint32_t m; (m = d[" << i / 32 << "]) != 0; ) {\n"
+					    << "\t\td[" << i / 32 << "] = m & (m - 1);\n"
+					    << "\t\tswitch (__builtin_ctz(m)) {\n";
+				}
+				out << "\t\tcase " << i % 32 << ":\n\t\t\tn = (";
+				for (int j = gates.inStart[k]; j < gates.inStart[k + 1]; j++) {
+					out << ((j > gates.inStart[k]) ? opSymbols[gates.op[k]] : "") << "(v[" << gates.in[j] << "] != 0)";
+				}
+				out << ((gates.op[k] >= NAND_OP) ? ") ^ 1;\n" : ");\n");
+				if (gates.rise[k] != 0 || gates.fall[k] != 0) {
+					out << "\t\t\tif (n != g[" << k << "]" 
+					    << ((gates.rise[k] == 0) ? " && n == 0" : (gates.fall[k] == 0) ? " && n == 1" : "") 
+					    << ") digisim_set(s, " << gates.out[k] << ", n);\n";
+				}
+				out << "\t\t\tg[" << k << "] = n;\n\t\t\tbreak;\n";
+			}
+			out << "\t\t}\n\t}\n}\n";
+		}
+
+		// settle: latch the clocked DFFs (flag 1 = clocked, 2 = latching in this pass), then evaluate the gates
+		out << "extern \"C\" void digisim_settle(NativeState* s) {\n"
+		    << "\tconst int dffCnt = " << dffCnt << ";\n"
+		    << "\tuint8_t* v = s->values;\n\tuint8_t* d = s->dffState;\n\tint more;\n"
+		    << "\tdo {\n"
+		    << "\t\tfor (int k = 0; k < dffCnt; k++) { if (d[4*k] & 1) d[4*k] = 2; }\n"
+		    << "\t\tfor (int k = 0; k < dffCnt; k++) {\n"
+		    << "\t\t\tif (!(d[4*k] & 2)) continue;\n"
+		    << "\t\t\tuint8_t clock = (v[dffClk[k]] == 1);\n"
+		    << "\t\t\tif (!d[4*k+1] && clock) { d[4*k+2] = v[dffD[k]]; d[4*k+3] = (v[dffD[k]] == 1) ? 0 : 1; }\n"
+		    << "\t\t\td[4*k+1] = clock;\n"
+		    << "\t\t}\n"
+		    << "\t\tfor (int k = 0; k < dffCnt; k++) {\n"
+		    << "\t\t\tif (!(d[4*k] & 2)) continue;\n"
+		    << "\t\t\td[4*k] &= 1;\n"
+		    << "\t\t\tdigisim_set(s, dffQ[k], d[4*k+2]);\n"
+		    << "\t\t\tdigisim_set(s, dffQn[k], d[4*k+3]);\n"
+		    << "\t\t}\n";
+		for (int c = 0; c < chunkCnt; c++) {
+			out << "\t\tgates" << c << "(s);\n";
+		}
+		out << "\t\tmore = 0;\n"
+		    << "\t\tfor (int k = 0; k < dffCnt; k++) more |= d[4*k];\n"
+		    << "\t} while (more);\n"
+		    << "}\n";
+	}
+
+	// ------------------------------------------- BIT-PARALLEL PATTERN SIMULATION -------------------------------------
+	// Pattern simulation evaluates the settled (zero delay) outputs of the Circuit for many input patterns at once. 
+	// Every Node holds a 64-bit word in which bit p is the Node's value under pattern p, so one pass over the gates 
+	// in level order simulates 64 patterns (256 or 512 with the SIMD pattern kernels, which take 4 or 8 words at a 
+	// time). The pattern inputs are the input Nodes of the netlist sorted by name, 
+	// which include the DFF Q/Qn outputs: DFFs are not clocked, their outputs are driven like primary inputs (full 
+	// scan, the same way FaultVectorGenerator has always applied test vectors). Stuck-at Nodes keep their stuck 
+	// value in every pattern. 
+
+	// This Function returns the Nodes driven by the pattern words passed to SimulatePatterns, in word order. 
+	vector<Node*> PatternInputs() {
+		vector<Node*> ins(inputnodes.begin(), inputnodes.end());
+		sort(ins.begin(), ins.end(), [](Node* x, Node* y) { return x->name < y->name; });
+		return ins;
+	}
+
+	// This Function returns the Nodes whose words are returned by SimulatePatterns, in word order. 
+	vector<Node*> PatternOutputs() {
+		vector<Node*> outs(outputnodes.begin(), outputnodes.end());
+		sort(outs.begin(), outs.end(), [](Node* x, Node* y) { return x->name < y->name; });
+		return outs;
+	}
+
+	// This Function returns true if the Circuit can be pattern simulated (it has no combinational loops). 
+	bool PatternSimulatable() {
+		return levelized;
+	}
+
+	// This Function selects the kernel used by SimulatePatterns (the default is the widest one the CPU supports). 
+	// Kernels the CPU does not support fall back to the scalar kernel. 
+	void SetPatternKernel(PatternKernel kernel) {
+		patternKernel = PatternKernelSupported(kernel) ? kernel : SCALAR_KERNEL;
+	}
+
+	// This Function flattens the gates into the pattern program in level order. The gates driving a stuck-at Node 
+	// write to a scratch Node (index nodeCnt) instead, so the Node keeps its stuck value; PatchPatternDrivers 
+	// redirects them when Nodes are made stuck-at or reverted, so the program is only built once per Circuit. 
+	void BuildPatternProgram() {
+		patternProgram = PatternProgram();
+		vector<pair<int,int>> drivers;
+		for (int k : levelOrder) {
+			for (int f = gates.inStart[k]; f < gates.inStart[k+1]; f++) {
+				patternProgram.in.push_back(gates.in[f]);
+			}
+			drivers.push_back(make_pair(gates.out[k], patternProgram.out.size()));
+			patternProgram.op.push_back(gates.op[k]);
+			patternProgram.out.push_back(gates.out[k]);
+			patternProgram.inStart.push_back(patternProgram.in.size());
+		}
+		patternDrivers.Build(nodeCnt, drivers);
+		patternProgramReady = true;
+		for (int n=0; n < nodeCnt; n++) {
+			if (nodeList[n]->StuckAtOp != 0) {
+				PatchPatternDrivers(n);
+			}
+		}
+	}
+
+	// This Function points the pattern program's gates driving Node n at the scratch Node if n is stuck-at, and 
+	// back at n otherwise. 
+	void PatchPatternDrivers(int n) {
+		if (!patternProgramReady) {
+			return;
+		}
+		for (int f = patternDrivers.Begin(n); f < patternDrivers.End(n); f++) {
+			patternProgram.out[patternDrivers.Item(f)] = (nodeList[n]->StuckAtOp != 0) ? nodeCnt : n;
+		}
+	}
+
+	// This Function simulates blocks of 64 input patterns. The passed inputWords holds one word per pattern input 
+	// for each block (block b, input i at inputWords[b*PatternInputs().size() + i]). Returns one word per pattern 
+	// output for each block, laid out the same way. Node values in the Circuit are not changed. The kernel takes 
+	// as many blocks per pass as it has words per Node. 
+	vector<uint64_t> SimulatePatterns(const vector<uint64_t>& inputWords) {
+		vector<Node*> ins = PatternInputs();
+		vector<Node*> outs = PatternOutputs();
+		vector<uint64_t> outputWords;
+		if (!levelized) {
+			cerr << "Error: cannot pattern simulate a netlist with combinational loops" << endl;
+			return outputWords;
+		}
+		if (ins.empty()) {
+			return outputWords;
+		}
+		if (!patternProgramReady) {
+			BuildPatternProgram();
+		}
+		size_t blockCnt = inputWords.size() / ins.size();
+		outputWords.resize(blockCnt * outs.size());
+
+		// stuck-at Nodes (and Nodes nothing drives) hold their current value in every pattern
+		size_t words = PatternKernelWords(patternKernel);
+		vector<uint64_t> values((nodeCnt + 1) * words); // the last Node is the scratch Node (see BuildPatternProgram)
+		for (int n=0; n < nodeCnt; n++) {
+			fill_n(values.begin() + n*words, words, (nodeList[n]->CurValue == ZERO) ? 0 : ~0ULL);
+		}
+		for (size_t b = 0; b < blockCnt; b += words) {
+			// word w of each Node holds block b+w (unused words of the last pass are left as they were)
+			size_t passCnt = min(words, blockCnt - b);
+			for (size_t i = 0; i < ins.size(); i++) {
+				if (ins[i]->StuckAtOp == 0) {
+					for (size_t w = 0; w < passCnt; w++) {
+						values[ins[i]->index*words + w] = inputWords[(b + w)*ins.size() + i];
+					}
+				}
+			}
+			RunPatternKernel(patternKernel, patternProgram, values.data());
+			for (size_t w = 0; w < passCnt; w++) {
+				for (size_t o = 0; o < outs.size(); o++) {
+					outputWords[(b + w)*outs.size() + o] = values[outs[o]->index*words + w];
+				}
+			}
+		}
+		return outputWords;
+	}
+
+	// ---------------------------------------------- BATCH SIMULATION ------------------------------------------------
+	// A simulation starts from the state the previous simulation left the Circuit in. Reset returns the Circuit to 
+	// the state of a new Circuit, so many stimulus files can be run against one loaded netlist (see 
+	// FunctionalSimulationBatch). 
+
+	// This Function restores the initial state of the Circuit (see RestoreState), like a new Circuit, except that 
+	// stuck-at Nodes stay stuck-at at their stuck value. The Event Queue needs no reset: every simulation runs it 
+	// until it is empty. 
+	void Reset() {
+		RestoreState(CircuitState(), true);
+	}
+
+	// This Function runs a Functional Simulation of the passed input file with the passed engine (see main). 
+	void FunctionalSimulation(string z, FunctionalEngine engine, bool dumpCycles) {
+		if (engine == CYCLE_ENGINE) {
+			FunctionalSimulationCycle(z, dumpCycles);
+		}
+		else if (engine == COMPILED_ENGINE) {
+			FunctionalSimulationCompiled(z);
+		}
+		else if (engine == LEVELIZED_ENGINE) {
+			FunctionalSimulationLevelized(z);
+		}
+		else {
+			FunctionalSimulation(z);
+		}
+	}
+
+	// -------------------------------------------- FUNCTIONAL SIMULATION v2 --------------------------------------------------
+	// This Function runs a Functional Simulation on the Circuit. It takes in as an argument the input file as a string. 
+	// Like the Timing Simulation, the Functional Simulation also uses an Event Queueing system but this time, all
+	// Events originating off a changing input will happen at the same time. i.e. there is 0 delay for all Component updates. 
+	// void FunctionalSimulation2(string z) {
+	//     cout << "Starting Functional Simulation" << endl;
+	//     ofstream OutputFile("FunctionalSimOutputv2.txt");
+	// 	OutputFile << "This file contains the Functional Simulation output:" << endl;
+
+	//     // Step 1: Propagate inputnodes to get initial state 
+	//     // we do this because of NAND/NOR/XNOR logic which could have initial logic 1
+	//     // when inputs are logical 0
+	//     for (Node* node : inputnodes) {
+	//         Propagate(node, 0, OutputFile, true);
+	//     }
+
+	//     // Done calculating initial state: 
+	// 	// next output initial node values to the output file at time 0
+	// 	for (set<Node*>::iterator i = nodes.begin(); i != nodes.end(); i++) {
+	// 		OutputFile << (*i)->name << " " << 0 << " " << (*i)->CurValue << endl;
+	// 	}
+
+	//     // Step 2: Read input changes into the priority queue
+	//     string line;
+	//     ifstream InputFile(z);
+
+
+	//     while (getline(InputFile, line)) {
+	//         stringstream linestream(line);
+	//         string input, newVals;
+	//         float time;
+	//         LogicValue newVal;
+
+	//         linestream >> time >> input >> newVals;
+	//         newVal = (newVals == "1") ? ONE : ZERO;
+
+	//         for (Node* node : nodes) {
+	//             if (node->name == input) {
+	//                 LogicValue oldVal = node->CurValue;  // Store previous value
+	//                 node->UpdateValue(newVal);          // Update value
+	//                 OutputFile << node->name << " " << time << " " << node->CurValue << endl;
+
+	//                 if (oldVal != node->CurValue) { 
+	//                     Propagate(node, time, OutputFile, false);
+	//                 }
+	//                 break;
+	//             }
+	//         }
+	//     }
+	//     InputFile.close();
+	// }
+
+	// // DFS Function to propagate signal changes
+	// // if initial pass, do not log outputs
+	// void Propagate(Node* node, float time, ofstream& OutputFile, bool ip) {
+	// 	for (int i = 0; i < compCnt; i++) {
+	//         Component* comp = comps[i];
+
+	//         // Check if this component has 'node' as an input
+	//         for (int j = 0; j < comp->inputNames.size(); j++) {
+	//             if (comp->inputs[j] == node) { 
+	//                 comp->Calculate();
+	//                 LogicValue oldOutput = comp->output->CurValue;
+	//                 comp->output->UpdateValue(comp->ReadOutput());
+
+	//                 if (oldOutput != comp->output->CurValue) { 
+	//                 	// record to output if not initial pass through
+	//                 	if (!ip) { OutputFile << comp->output->name << " " << time << " " << comp->output->CurValue << endl; }
+	//                     Propagate(comp->output, time, OutputFile, ip);  // **Recursive DFS call**
+	//                 }
+	//                 break;  // No need to check other inputs if this node matches
+	//             }
+	//         }
+	//     }
+	// }
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This Function changes the passed Node into a stuck-at-y Node where y is passed in. 
+	void CreateStuckAt(string x, LogicValue y) {
+		// Change passed Node to a Stuck-At-y Node. 
+		// look the node up by name and turn it into a stuck-at-y node
+		if (Node* node = FindNode(x)) {
+			node->MakeStuckAt(y);
+			PatchPatternDrivers(node->index); // the pattern program's gates driving a stuck-at Node are redirected
+		}
+	}
+
+	// This Function reverts the passed stuck-at Node to a normal Node (it keeps its stuck value until it changes). 
+	void UndoStuckAt(string x) {
+		if (Node* node = FindNode(x)) {
+			node->UndoStuckAt();
+			PatchPatternDrivers(node->index);
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This helper Function just returns the node names set from the circuit. 
+	set<string> CircuitNodeNames() {
+		set<string> names;
+		for (Node* node : nodeList) {
+			names.insert(node->name);
+		}
+		return names;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This helper Function returns a set of input names from the circuit. 
+	set<string> CircuitInputNames() {
+		set<string> names;
+		for(set<Node*>::iterator k = inputnodes.begin(); k != inputnodes.end(); k++) {
+	        names.insert((*k)->name);
+	    }
+	    return names;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This helper function returns a vector of tuples containing input Node (names, logic value) for the Circuit. 
+	vector<tuple<string,int>> CircuitInputs() {
+		vector<tuple<string, int>> inputs; 
+		for (set<Node*>::iterator i = inputnodes.begin(); i != inputnodes.end(); i++) {
+			inputs.push_back(make_tuple((*i)->name, (*i)->CurValue));
+		}
+		return inputs;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------
+	// This helper function returns a vector of tuples containing input Node (names, logic value) for the Circuit. 
+	vector<tuple<string,int>> CircuitOutputs() {
+		vector<tuple<string, int>> outputs; 
+		for (set<Node*>::iterator i = outputnodes.begin(); i != outputnodes.end(); i++) {
+			outputs.push_back(make_tuple((*i)->name, (*i)->CurValue));
+		}
+		return outputs;
+	}
+};
+
+// ----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------- FAULT VECTOR GENERATOR ---------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------------------
+// This class implements the Fault Vector Generator for the system. The Fault Vector Generator is constructed with a 
+// passed string netlist file. It creates the Circuit object from that netlist as well as additional faulty stuck-at 
+// circuits. For each Node defined in the netlist there will be 2 possible stuck-ats and thus 2 associated faulty Circuits. 
+// The Fault Vector Generator runs randomly generated test vectors on all of these Circuits and detects faults by comparing 
+// the outputs of the "Good" Circuit to the outputs of the "Faulty" Circuits. A fault is detected if the outputs differ. 
+// The generator operates on a trial-and-error basis. On each trial, it runs a number of test vectors on the Good and Faulty
+// Circuits. The number of tests per trial is determined by the number of remaining faults to be detected. After running all 
+// of the tests for a trial, the generator determines which test vector had the best coverage on the remaining faults and 
+// adds it to the list of Fault Vectors. All of the faulty Circuits detected by this max coverage test vector are then 
+// removed before running the next trial. This process continues until the user-input coverage (% faults detected) is satisfied. 
+//. 
+class FaultVectorGenerator {
+private:
+	// A faulty circuit is a fault machine: a stuck-at Node and the state of the machine's last simulation, applied in
+	// turn to one Circuit sharing the Good Circuit's netlist (see Apply). Its state stays empty until the machine is 
+	// first simulated with the Event Queue, since pattern simulations leave no state behind. 
+	struct FaultMachine {
+		string node;         // name of the stuck-at Node
+		LogicValue value;    // value the Node is stuck at
+		CircuitState state;  // state after the machine's last FunctionalSimulation (see Circuit::SaveState)
+	};
+
+	vector<FaultMachine> machines;
+	set<FaultMachine*> faultyCircuits;
+	Circuit* GoodCircuit;
+	Circuit* FaultyCircuit;
+public:
+	// The Constructor for the FaultVectorGenerator takes a string input netlist from 
+	// the user and creates circuits for the generator. One correct circuit is created 
+	// along with 2*(# of nodes) faulty circuits each with a single stuck-at-1/0 node. 
+	// The netlist is only read once: the faulty circuits are fault machines on a second 
+	// Circuit sharing the correct circuit's netlist (loaded from its netlist image unless 
+	// images is false, see Netlist). 
+	FaultVectorGenerator(string x, bool images = true) {
+		// Create a Good (No Fault) Circuit
+		GoodCircuit = new Circuit(x, images);
+		FaultyCircuit = new Circuit(GoodCircuit->SharedNetlist());
+		// Grab all node names (including inputs/outputs) for the circuit
+		set<string> allNodeNames = GoodCircuit->CircuitNodeNames();
+
+		// Next, create faulty circuit(s): a stuck-at-0 and a stuck-at-1 machine for each node
+		machines.reserve(2*allNodeNames.size());
+		for (set<string>::iterator j = allNodeNames.begin(); j != allNodeNames.end(); j++) {
+			machines.push_back({*j, ZERO, CircuitState()});
+			machines.push_back({*j, ONE, CircuitState()});
+		}
+		for (size_t m = 0; m < machines.size(); m++) {
+			faultyCircuits.insert(&machines[m]);
+		}
+	}
+
+	// This Function applies the passed fault machine to the faulty Circuit: its saved state (the initial state 
+	// before its first simulation) and its stuck-at Node. 
+	void Apply(FaultMachine* m) {
+		FaultyCircuit->RestoreState(m->state);
+		FaultyCircuit->CreateStuckAt(m->node, m->value);
+	}
+
+	// This Function takes as an integer input (0-100), the amount of coverage % requested
+	// by the user and generates a set of test vectors which achieves that coverage. The 
+	// generated vectors are written to the file TestVectorOutput.txt in the directory the
+	// program is being run from. 
+	// The program has a set bin size of 20 runs in each of which a test vector is generated and
+	// run on all of the faulty circuits. After 10 runs/vectors are tested, the vector providing
+	// the most coverage is selected and written to the file. The number of remaining faults is 
+	// updated before repeating the same process over again. 
+	void Generate(double x) {
+		// required minimum test vector coverage = x
+		double required_coverage = x/double(100);
+		double total_coverage = 0;
+		int total_faults = size(faultyCircuits);
+		int vector_cnt = 0;
+
+		// Grab input names for the circuit
+		set<string> inputNames = GoodCircuit->CircuitInputNames();
+
+		ofstream TestVectorOutput("FaultVectors.txt");
+		TestVectorOutput << "This file contains a set of test vectors providing " << required_coverage*100 << 
+							"% fault coverage on the given circuit: " << endl;
+
+		while ((required_coverage - total_coverage) > 0.001) {
+			// # of test vector cases to run this trial is equal to the number of the remaining faults left to 
+			// detect for the circuit. This way, we only run 1 test vector per trial when there is 1 fault 
+			// remaining. 
+			int caseCnt = faultyCircuits.size();
+			// responses to each test vector
+			vector<tuple<int,set<FaultMachine*>,vector<tuple<string,int>>>> responses;
+			// Get seed for pseudo-random number generator.
+			srand(time(0));
+			// Netlists without combinational loops test all the vectors together (see CalculatePatterns). 
+			if (GoodCircuit->PatternSimulatable()) {
+				responses.push_back(CalculatePatterns(caseCnt));
+			}
+			else {
+				for (int i = 0; i<caseCnt; i++) {
+					// Create test vector 
+					string testVectorName = "testVector.txt";
+					ofstream Vector(testVectorName);
+					for (set<string>::iterator i = inputNames.begin(); i != inputNames.end(); i++) {
+						// Generate random bit (0/1)
+						int randombit = rand() % 2;
+						// Create test value for input
+						Vector << 0 << " " << (*i) << " " << randombit << endl;
+					}
+					Vector.close();
+
+					// Calculate coverage of this test vector
+					tuple<int,set<FaultMachine*>,vector<tuple<string,int>>> vector_coverage = Calculate(testVectorName);
+					// Add the coverage of this test to the list of all responses
+					responses.push_back(vector_coverage);
+
+					// Convert test vector file name to array of chars so we can remove it. 
+					const char* testVectorNameChars = testVectorName.c_str();
+					remove (testVectorNameChars);
+				}
+			}
+
+			// returns a pointer to the largest coverage tuple in the vector of responses. 
+			auto largest_coverage = max_element(responses.begin(), responses.end(),
+	                                            [](const tuple<int, set<FaultMachine*>, vector<tuple<string,int>>> &x,
+	                                            const tuple<int, set<FaultMachine*>, vector<tuple<string,int>>> &y) {
+	                                            return get<0>(x) < get<0>(y);
+	                                           });
+
+			set<FaultMachine*> faults_covered = get<1>(*largest_coverage);
+			total_coverage += ((double)get<0>(*largest_coverage)/(double)total_faults);
+
+			// Only record test vector if it detected faults 
+			if (get<0>(*largest_coverage) != 0) {
+				cout << "Total Coverage: " << total_coverage*100 << "%" << endl;
+				for (set<FaultMachine*>::iterator j = faults_covered.begin(); j != faults_covered.end(); j++) {
+					faultyCircuits.erase(*j);
+				}
+
+				// Make header
+				vector_cnt += 1;
+				TestVectorOutput << "---------------" << " Test Vector #" << vector_cnt << " ---------------" << endl;
+
+				// Write test vector under header
+				vector<tuple<string,int>> testvector = get<2>(*largest_coverage);
+				for (vector<tuple<string,int>>::iterator k = testvector.begin(); k != testvector.end(); k++) {
+					TestVectorOutput << get<0>(*k) << " " << get<1>(*k) << endl;
+				}
+
+				TestVectorOutput << "Total Coverage = " << total_coverage << endl;
+			}
+
+		}
+
+		TestVectorOutput.close();
+	}
+
+// -----------------------------------------------------------------------------------------------------------------------
+	/*
+	This function takes as an input a filename to a test vector. The Calculate function
+	then runs functional simulations on the normal circuit as well as faulty circuits with 
+	stuck-at-faults. The function returns with the integer coverage of the test vector
+	and a set of pointers to all the detected stuck-at-fault circuits. Also returned is 
+	the test vector itself -> names and values of the inputs. 
+	*/
+	tuple<int,set<FaultMachine*>,vector<tuple<string,int>>> Calculate(string x) {
+		// Make set of pointers to faulty circuits. At the end we will return with the 
+		// set of faulty circuits that were detected. 
+		set<FaultMachine*> bustedCircuits;
+
+		// Run functional simulation on the test vector.
+		GoodCircuit->FunctionalSimulation(x);
+		// Grab the test vector as well to return it 
+		vector<tuple<string,int>> test_inputs = GoodCircuit->CircuitInputs();
+
+		// Grab functional simulation correct outputs; 
+		vector<tuple<string,int>> correctoutputs = GoodCircuit->CircuitOutputs();
+
+		// Next, simulate faulty circuit(s) on the same test vector
+		int detectedFaults = 0;
+		for (set<FaultMachine*>::iterator i = faultyCircuits.begin(); i != faultyCircuits.end(); i++) {
+			Apply(*i);
+			FaultyCircuit->FunctionalSimulation(x);
+			(*i)->state = FaultyCircuit->SaveState();
+
+			vector<tuple<string,int>> faultyoutputs = FaultyCircuit->CircuitOutputs();
+			vector<tuple<string,int>> reorder_faultyoutputs; 
+			for (vector<tuple<string,int>>::iterator j = correctoutputs.begin(); j != correctoutputs.end(); j++) {
+				for (vector<tuple<string,int>>::iterator k = faultyoutputs.begin(); k != faultyoutputs.end(); k++) {
+					if (get<0>(*j) == get<0>(*k)) {
+						reorder_faultyoutputs.push_back(*k);
+					}
+				}
+			}
+
+			if (reorder_faultyoutputs != correctoutputs) { 
+				detectedFaults += 1; 
+				bustedCircuits.insert((*i));
+			}
+		}
+
+		// We return with the following values below:
+		// 1.) the # of detected faults by this test vector
+		// 2.) pointers to the faulty circuits that were detected
+		// 3.) input test vector names & values
+		return {detectedFaults, bustedCircuits, test_inputs};
+	}
+
+// -----------------------------------------------------------------------------------------------------------------------
+	/*
+	This function is the bit-parallel version of Calculate. It generates patternCnt random test vectors 
+	and runs them through the normal circuit and every faulty circuit with one pattern simulation each 
+	(see Circuit::SimulatePatterns), packed 64 vectors per word. A fault is detected by a vector if any 
+	output differs from the normal circuit's output. The function returns the same values as Calculate 
+	for the vector detecting the most faults (the first such vector on a tie). 
+	*/
+	tuple<int,set<FaultMachine*>,vector<tuple<string,int>>> CalculatePatterns(int patternCnt) {
+		vector<Node*> inputs = GoodCircuit->PatternInputs();
+		size_t inputCnt = inputs.size();
+		int blockCnt = (patternCnt + 63) / 64;
+		if (blockCnt == 0) {
+			return {0, set<FaultMachine*>(), vector<tuple<string,int>>()};
+		}
+
+		// Create the random test vectors: bit p of input i's word in block b is the input's value in vector 64*b+p
+		vector<uint64_t> inputWords(blockCnt * inputCnt, 0);
+		for (int v = 0; v < patternCnt; v++) {
+			for (size_t i = 0; i < inputCnt; i++) {
+				inputWords[(v/64)*inputCnt + i] |= (uint64_t)(rand() % 2) << (v%64);
+			}
+		}
+
+		// Simulate the normal circuit, then find the vectors detecting each faulty circuit
+		vector<uint64_t> correctoutputs = GoodCircuit->SimulatePatterns(inputWords);
+		size_t outputCnt = correctoutputs.size() / blockCnt;
+		vector<pair<FaultMachine*, vector<uint64_t>>> detections;
+		vector<int> detectedFaults(patternCnt, 0);
+		for (set<FaultMachine*>::iterator i = faultyCircuits.begin(); i != faultyCircuits.end(); i++) {
+			// pattern simulations only need the stuck-at Node (see Circuit::SimulatePatterns)
+			FaultyCircuit->CreateStuckAt((*i)->node, (*i)->value);
+			vector<uint64_t> faultyoutputs = FaultyCircuit->SimulatePatterns(inputWords);
+			FaultyCircuit->UndoStuckAt((*i)->node);
+			vector<uint64_t> detected(blockCnt, 0);
+			bool any = false;
+			for (int b = 0; b < blockCnt; b++) {
+				for (size_t o = 0; o < outputCnt; o++) {
+					detected[b] |= correctoutputs[b*outputCnt + o] ^ faultyoutputs[b*outputCnt + o];
+				}
+				any = any || (detected[b] != 0);
+			}
+			if (any) {
+				for (int v = 0; v < patternCnt; v++) {
+					detectedFaults[v] += (detected[v/64] >> (v%64)) & 1;
+				}
+				detections.push_back(make_pair(*i, detected));
+			}
+		}
+
+		// Pick the vector detecting the most faults
+		int best = 0;
+		for (int v = 1; v < patternCnt; v++) {
+			best = (detectedFaults[v] > detectedFaults[best]) ? v : best;
+		}
+		set<FaultMachine*> bustedCircuits;
+		for (size_t d = 0; d < detections.size(); d++) {
+			if ((detections[d].second[best/64] >> (best%64)) & 1) {
+				bustedCircuits.insert(detections[d].first);
+			}
+		}
+		vector<tuple<string,int>> test_inputs;
+		for (size_t i = 0; i < inputCnt; i++) {
+			test_inputs.push_back(make_tuple(inputs[i]->name, (int)((inputWords[(best/64)*inputCnt + i] >> (best%64)) & 1)));
+		}
+		return {detectedFaults[best], bustedCircuits, test_inputs};
+	}
+
+	~FaultVectorGenerator(void) { 
+		// delete faulty and good Circuits 
+		delete FaultyCircuit;
+		delete GoodCircuit;
+	}
+};
+
+
+// ----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------- BATCH SIMULATION ------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------------------
+// This Function returns the waveform file written by run r (counted from 0) of a batch. 
+string BatchOutputFile(size_t r) {
+	return "FunctionalSimOutput_" + to_string(r + 1) + ".vcd";
+}
+
+// This Function returns the summary of a batch run: the input file and the values of the passed output Nodes. 
+string BatchSummary(const string& inputFile, const vector<Node*>& outs) {
+	ostringstream summary;
+	summary << "--------------- " << inputFile << " ---------------" << endl;
+	for (Node* node : outs) {
+		summary << node->name << " " << node->CurValue << endl;
+	}
+	return summary.str();
+}
+
+// This Function runs a Functional Simulation of each passed input file on the netlist with the passed engine, on 
+// threadCnt worker threads. Each worker creates one Circuit on the shared netlist, so the netlist is read once and 
+// each thread only owns its Node values, gate outputs and DFF states. A worker takes the next input file in the 
+// list until none are left, resetting its Circuit before each run (see Circuit::Reset). Run r writes its waveform 
+// to BatchOutputFile(r) with the passed waveform options, and the output Node values at the end of each run (sorted 
+// by name) are written to the summary file in list order, so the files written do not depend on the number of 
+// threads. 
+void FunctionalSimulationBatch(shared_ptr<const Netlist> net, const vector<string>& inputFiles, SchedulerType scheduler,
+                               FunctionalEngine engine, bool dumpCycles, const WaveformOptions& waveform, int threadCnt, 
+                               string summaryFile) {
+	vector<string> summaries(inputFiles.size());
+	atomic<size_t> next(0);
+	WorkerPool pool(max(1, min(threadCnt, (int)inputFiles.size())));
+	pool.Run([&](int) {
+		Circuit C(net);
+		C.SetScheduler(scheduler);
+		C.SetWaveformOptions(waveform);
+		vector<Node*> outs = C.PatternOutputs();
+		for (size_t r = next++; r < inputFiles.size(); r = next++) {
+			C.Reset();
+			C.SetOutputFiles("TimingSimOutput_" + to_string(r + 1) + ".vcd", BatchOutputFile(r));
+			C.FunctionalSimulation(inputFiles[r], engine, dumpCycles);
+			summaries[r] = BatchSummary(inputFiles[r], outs);
+		}
+	});
+
+	ofstream Summary(summaryFile);
+	for (const string& summary : summaries) {
+		Summary << summary;
+	}
+	Summary.close();
+	cout << "Batch of " << inputFiles.size() << " Functional Simulations Complete (" << pool.Size() << " threads), "
+	     << "output values stored in " << summaryFile << endl;
+}
+
+
+// ----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- BENCHMARKS ---------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------------------
+// The functions below implement the built-in benchmarks, run from the terminal with "digisim --bench <name>". The 
+// benchmarks generate synthetic netlists in the directory the program is run from and remove them when finished. 
+// They time reading the netlist text (their Circuits are created with images false), except the netlist image 
+// benchmark. 
+
+// This helper Function returns the number of seconds elapsed since start. 
+double SecondsSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// This helper Function returns the resident memory of the program in kB (or its peak so far, field "VmHWM:"), or 
+// -1 where /proc is not available. 
+long ResidentKB(string field = "VmRSS:") {
+	ifstream Status("/proc/self/status");
+	string line;
+	while (getline(Status, line)) {
+		if (line.compare(0, field.size(), field) == 0) {
+			return atol(line.c_str() + field.size());
+		}
+	}
+	return -1;
+}
+
+// This helper class silences cout (the "Circuit Netlist Mapped" and progress lines of the simulators) while it is in
+// scope, or sends it to the passed stream instead so a test can compare the setup/hold violation reports.
+class QuietConsole {
+public:
+	QuietConsole(ostream* capture = NULL) {
+		console = cout.rdbuf(capture ? capture->rdbuf() : NULL);
+	}
+	~QuietConsole() {
+		cout.rdbuf(console);
+		cout.clear();
+	}
+private:
+	streambuf* console;
+};
+
+// This helper Function returns the contents of the passed file (empty if it cannot be read).
+string FileContents(string file) {
+	ifstream File(file, ios::binary);
+	stringstream contents;
+	contents << File.rdbuf();
+	return contents.str();
+}
+
+// This Function writes a random acyclic combinational netlist in P-Silos format to the passed file. The netlist has
+// inputCnt primary inputs (In0, In1, ...) and gateCnt gates (N0, N1, ...). Every gate draws 2-4 inputs from the 
+// inputs and earlier gates, so the netlist is always levelizable. Delays are drawn from the 50-550 range of test5. 
+void WriteSyntheticNetlist(string file, int gateCnt, int inputCnt, unsigned seed) {
+	const char* gateTypes[6] = {".AND", ".OR", ".XOR", ".NAND", ".NOR", ".XNOR"};
+	mt19937 rng(seed);
+	ofstream Netlist(file);
+	Netlist << "# Synthetic netlist: " << gateCnt << " gates, " << inputCnt << " inputs" << "\n";
+	for (int i = 0; i < gateCnt; i++) {
+		int fanin = 2 + rng() % 3;
+		Netlist << "N" << i << " " << gateTypes[rng() % 6] << " " << 50 + rng() % 501 << " " << 50 + rng() % 501;
+		for (int j = 0; j < fanin; j++) {
+			// pick a driver from the primary inputs or any earlier gate
+			int src = rng() % (inputCnt + i);
+			if (src < inputCnt) {
+				Netlist << " In" << src;
+			}
+			else {
+				Netlist << " N" << src - inputCnt;
+			}
+		}
+		Netlist << "\n";
+	}
+	Netlist.close();
+}
+
+// This Function writes a random stimulus file for a synthetic netlist. changeCnt input changes are spread evenly
+// over time, one every spacing time units, each setting a random primary input (In0, In1, ...) to a random value. 
+void WriteSyntheticStimulus(string file, int inputCnt, int changeCnt, int spacing, unsigned seed) {
+	mt19937 rng(seed);
+	ofstream Stimulus(file);
+	for (int i = 0; i < changeCnt; i++) {
+		Stimulus << i*spacing << " In" << rng() % inputCnt << " " << rng() % 2 << "\n";
+	}
+	Stimulus.close();
+}
+
+// This Function writes a random synchronous netlist in P-Silos format to the passed file: gateCnt gates (N0, N1, 
+// ...) as in WriteSyntheticNetlist that also read the outputs of dffCnt DFFs (Q0, Q1, ...), all clocked by CLK. 
+// Each DFF latches a random gate output, so the DFFs and the gates between them form a random state machine. 
+void WriteSyntheticSequentialNetlist(string file, int gateCnt, int dffCnt, int inputCnt, unsigned seed) {
+	const char* gateTypes[6] = {".AND", ".OR", ".XOR", ".NAND", ".NOR", ".XNOR"};
+	mt19937 rng(seed);
+	ofstream Netlist(file);
+	Netlist << "# Synthetic netlist: " << gateCnt << " gates, " << dffCnt << " DFFs, " << inputCnt << " inputs" << "\n";
+	for (int i = 0; i < gateCnt; i++) {
+		int fanin = 2 + rng() % 3;
+		Netlist << "N" << i << " " << gateTypes[rng() % 6] << " " << 50 + rng() % 501 << " " << 50 + rng() % 501;
+		for (int j = 0; j < fanin; j++) {
+			// pick a driver from the primary inputs, the DFF outputs or any earlier gate
+			int src = rng() % (inputCnt + dffCnt + i);
+			if (src < inputCnt) {
+				Netlist << " In" << src;
+			}
+			else if (src < inputCnt + dffCnt) {
+				Netlist << " Q" << src - inputCnt;
+			}
+			else {
+				Netlist << " N" << src - inputCnt - dffCnt;
+			}
+		}
+		Netlist << "\n";
+	}
+	for (int k = 0; k < dffCnt; k++) {
+		Netlist << "DFF" << k << " .DFF 400 50 N" << rng() % gateCnt << " CLK Q" << k << " Q" << k << "n\n";
+	}
+	Netlist.close();
+}
+
+// This Function writes a clocked stimulus file for a synthetic sequential netlist: cycleCnt periods of CLK (rising 
+// at 0, 1000, 2000, ... and falling half way), with changesPerCycle random input changes a quarter period after 
+// each rising edge. 
+void WriteSyntheticClockedStimulus(string file, int inputCnt, int cycleCnt, int changesPerCycle, unsigned seed) {
+	mt19937 rng(seed);
+	ofstream Stimulus(file);
+	for (int c = 0; c < cycleCnt; c++) {
+		Stimulus << c*1000 << " CLK 1\n";
+		for (int i = 0; i < changesPerCycle; i++) {
+			Stimulus << c*1000 + 250 << " In" << rng() % inputCnt << " " << rng() % 2 << "\n";
+		}
+		Stimulus << c*1000 + 500 << " CLK 0\n";
+	}
+	Stimulus.close();
+}
+
+// This Function writes the netlist and stimulus the waveform benchmarks simulate: 100000 gates on 2000 inputs (see
+// WriteSyntheticNetlist) and 5000 input changes 10 time units apart.
+void WriteWaveformBenchFiles(string netlist, string stimulus) {
+	WriteSyntheticNetlist(netlist, 100000, 2000, 12);
+	WriteSyntheticStimulus(stimulus, 2000, 5000, 10, 13);
+}
+
+// This Function runs a Timing Simulation of the stimulus on a new Circuit of the netlist with the passed waveform
+// options and cout silenced, and returns its run time in seconds (not counting reading the netlist). If stallSeconds
+// is passed, it is set to the time the simulator spent waiting on the waveform writer (see Circuit::WaveformStall).
+double RunTimingQuietly(string netlist, string stimulus, const WaveformOptions& options, double* stallSeconds = NULL) {
+	QuietConsole quiet;
+	Circuit C(netlist, false);
+	C.SetWaveformOptions(options);
+	auto start = chrono::steady_clock::now();
+	C.TimingSimulation(stimulus);
+	double seconds = SecondsSince(start);
+	if (stallSeconds) {
+		*stallSeconds = C.WaveformStall();
+	}
+	return seconds;
+}
+
+// Netlist load benchmark: maps synthetic netlists of doubling size and reports the load time per gate. 
+// With hashed name lookup the time per gate should stay flat as the netlist grows (linear scaling). 
+void BenchNetlistLoad() {
+	string file = "bench_netlist.txt";
+	cout << "gates      load (s)    us/gate" << endl;
+	for (int gates = 25000; gates <= 400000; gates *= 2) {
+		WriteSyntheticNetlist(file, gates, gates/10, 1);
+		auto start = chrono::steady_clock::now();
+		Circuit *C = new Circuit(file, false);
+		double seconds = SecondsSince(start);
+		delete C;
+		printf("%-10d %-11.3f %.3f\n", gates, seconds, 1e6*seconds/gates);
+	}
+	remove(file.c_str());
+}
+
+// Parser throughput benchmark: reports MB/s for cutting a large synthetic netlist and stimulus into tokens with 
+// getline and stringstream and with TextScanner over the mapped file, then for the whole netlist load (parse and 
+// build the Circuit) and for pulling every change from a StimulusStream. 
+void BenchParser() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteSyntheticNetlist(netlist, 1000000, 20000, 20);
+	WriteSyntheticStimulus(stimulus, 20000, 4000000, 10, 21);
+	printf("file       stage                      MB        time (s)   MB/s\n");
+	string files[2] = {netlist, stimulus};
+	for (int f = 0; f < 2; f++) {
+		double MB = filesystem::file_size(files[f]) / 1e6;
+		const char* name = (f == 0) ? "netlist" : "stimulus";
+		// tokenize the file the old way and the new way (the token counts are printed to check they agree)
+		auto start = chrono::steady_clock::now();
+		long long streamTokens = 0;
+		ifstream File(files[f]);
+		string line, token;
+		while (getline(File, line)) {
+			stringstream linestream(line);
+			while (linestream >> token && token[0] != '#') {
+				streamTokens++;
+			}
+		}
+		double seconds = SecondsSince(start);
+		printf("%-10s %-26s %-9.1f %-10.3f %.1f\n", name, "getline + stringstream", MB, seconds, MB/seconds);
+		start = chrono::steady_clock::now();
+		long long scanTokens = 0;
+		MappedFile Mapped(files[f]);
+		TextScanner text(Mapped.Text());
+		while (text.NextLine()) {
+			for (string_view t = text.Token(); !t.empty(); t = text.Token()) {
+				scanTokens++;
+			}
+		}
+		seconds = SecondsSince(start);
+		printf("%-10s %-26s %-9.1f %-10.3f %.1f  (tokens %s)\n", name, "mapped TextScanner", MB, seconds, MB/seconds, 
+		       (scanTokens == streamTokens) ? "agree" : "DIFFER");
+	}
+	// full parse: netlist load and stimulus stream
+	auto start = chrono::steady_clock::now();
+	Circuit *C = new Circuit(netlist, false);
+	double seconds = SecondsSince(start);
+	double MB = filesystem::file_size(netlist) / 1e6;
+	printf("%-10s %-26s %-9.1f %-10.3f %.1f\n", "netlist", "Circuit load", MB, seconds, MB/seconds);
+	start = chrono::steady_clock::now();
+	long long changes = 0;
+	for (StimulusStream stream(stimulus, C->NodeLookup()); !stream.Empty(); stream.Pop()) {
+		changes++;
+	}
+	seconds = SecondsSince(start);
+	MB = filesystem::file_size(stimulus) / 1e6;
+	printf("%-10s %-26s %-9.1f %-10.3f %.1f  (%lld changes)\n", "stimulus", "StimulusStream", MB, seconds, MB/seconds, 
+	       changes);
+	delete C;
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+}
+
+// Netlist image benchmark: times making a Circuit from synthetic netlists of growing size by reading the netlist text,
+// by reading it and saving its image (the first run on a netlist), and by loading the image. Then times making a 
+// Fault Vector Generator (2N+1 Circuits of the same netlist) without and with images. 
+void BenchNetlistImages() {
+	string file = "bench_netlist.txt";
+	string image = Netlist::ImagePath(file);
+	cout << "gates      text (s)    text+save (s)  image (s)   speedup   image MB" << endl;
+	for (int gates = 100000; gates <= 1600000; gates *= 4) {
+		WriteSyntheticNetlist(file, gates, gates/10, 1);
+		remove(image.c_str());
+		double seconds[3];
+		for (int run = 0; run < 3; run++) {
+			// run 0 reads the text only, run 1 reads it and saves the image, run 2 loads the image
+			auto start = chrono::steady_clock::now();
+			Circuit *C = new Circuit(file, run > 0);
+			seconds[run] = SecondsSince(start);
+			delete C;
+		}
+		printf("%-10d %-11.3f %-14.3f %-11.3f %-9.1f %.1f\n", gates, seconds[0], seconds[1], seconds[2], 
+		       seconds[0]/seconds[2], filesystem::file_size(image) / 1e6);
+		remove(image.c_str());
+	}
+
+	// the Fault Vector Generator's Circuits (their "Circuit Netlist Mapped" lines are not printed)
+	WriteSyntheticNetlist(file, 2000, 200, 2);
+	cout << "Fault Vector Generator, 2000 gates" << endl;
+	for (int run = 0; run < 2; run++) {
+		QuietConsole quiet;
+		auto start = chrono::steady_clock::now();
+		FaultVectorGenerator *Generator = new FaultVectorGenerator(file, run == 1);
+		double seconds = SecondsSince(start);
+		delete Generator;
+		printf("  %-20s %.3f s\n", (run == 0) ? "text" : "images", seconds);
+	}
+	remove(file.c_str());
+	remove(image.c_str());
+}
+
+// Fault machine benchmark: times making a Fault Vector Generator (one Circuit and 2N fault machines) for synthetic 
+// netlists of growing size with the memory it takes, and one pass of 64 random test vectors over all its faults. 
+void BenchFaultMachines() {
+	string file = "bench_netlist.txt";
+	cout << "gates      nodes      machines   create (s)  memory (MB)  64 vectors (s)" << endl;
+	for (int gates = 2000; gates <= 8000; gates *= 2) {
+		WriteSyntheticNetlist(file, gates, gates/10, 3);
+		QuietConsole quiet;
+		long startKB = ResidentKB();
+		auto start = chrono::steady_clock::now();
+		FaultVectorGenerator *Generator = new FaultVectorGenerator(file, false);
+		double createSeconds = SecondsSince(start);
+		long memoryKB = ResidentKB() - startKB;
+		start = chrono::steady_clock::now();
+		int detected = get<0>(Generator->CalculatePatterns(64));
+		double passSeconds = SecondsSince(start);
+		delete Generator;
+		int nodes = gates + gates/10;
+		printf("%-10d %-10d %-10d %-11.3f %-12.1f %.3f (best vector detects %d)\n", gates, nodes, 2*nodes, createSeconds, 
+		       memoryKB / 1024.0, passSeconds, detected);
+	}
+	remove(file.c_str());
+}
+
+// Batch benchmark: times 64 Functional Simulations of short input files on a synthetic netlist, making a new Circuit
+// for each run (how main runs one simulation), and with FunctionalSimulationBatch (one Circuit per thread, reset 
+// between runs) on 1 to 16 threads. Checks every batch writes the same summary. 
+void BenchBatch() {
+	string netlist = "bench_netlist.txt";
+	WriteSyntheticNetlist(netlist, 100000, 2000, 12);
+	int runCnt = 64;
+	vector<string> inputFiles;
+	for (int r = 0; r < 8; r++) {
+		inputFiles.push_back("bench_input" + to_string(r) + ".txt");
+		WriteSyntheticStimulus(inputFiles.back(), 2000, 500, 10, 13 + r);
+	}
+	while ((int)inputFiles.size() < runCnt) {
+		inputFiles.push_back(inputFiles[inputFiles.size() % 8]);
+	}
+	printf("%d runs, 100000 gates, 500 input changes each\n", runCnt);
+	QuietConsole quiet;
+	auto start = chrono::steady_clock::now();
+	for (int r = 0; r < runCnt; r++) {
+		Circuit *C = new Circuit(netlist, false);
+		C->FunctionalSimulation(inputFiles[r]);
+		delete C;
+	}
+	double fresh = SecondsSince(start);
+	printf("  new Circuit per run     %.3f s (%.1f ms per run)\n", fresh, 1000*fresh/runCnt);
+	string first;
+	for (int threadCnt = 1; threadCnt <= 16; threadCnt *= 2) {
+		start = chrono::steady_clock::now();
+		shared_ptr<const Netlist> net = make_shared<const Netlist>(netlist, false);
+		FunctionalSimulationBatch(net, inputFiles, HEAP_SCHEDULER, EVENT_ENGINE, false, WaveformOptions(), threadCnt, 
+		                          "bench_summary.txt");
+		double batch = SecondsSince(start);
+		string summary = FileContents("bench_summary.txt");
+		first = (threadCnt == 1) ? summary : first;
+		printf("  batch, %2d threads       %.3f s (%.1f ms per run)%s\n", threadCnt, batch, 1000*batch/runCnt, 
+		       (summary == first) ? "" : "  SUMMARY DIFFERS");
+	}
+	remove(netlist.c_str());
+	for (int r = 0; r < runCnt; r++) {
+		remove(inputFiles[r].c_str());
+		remove(BatchOutputFile(r).c_str());
+	}
+	remove("bench_summary.txt");
+	remove("FunctionalSimOutput.vcd");
+}
+
+// VCD writer benchmark: writes the same 4M Node changes (100000 Nodes, about 8 changes per time step, a quarter of 
+// them repeating the Node's value) with the former per-event ofstream writer ("#time" line and "s<N>" identifier 
+// for every change) and with VCDWriter, and reports changes/sec and file size. Then times a timing simulation, 
+// where the writer is most of the work. 
+void BenchVCD() {
+	int nodeCnt = 100000, changeCnt = 4000000;
+	vector<Node*> nodes;
+	for (int i = 0; i < nodeCnt; i++) {
+		nodes.push_back(new Node("Node" + to_string(i), i));
+	}
+	mt19937 rng(14);
+	vector<int> target(changeCnt);
+	vector<LogicValue> value(changeCnt);
+	vector<char> last(nodeCnt, 0);
+	for (int c = 0; c < changeCnt; c++) {
+		target[c] = rng() % nodeCnt;
+		last[target[c]] ^= (rng() % 4 != 0);
+		value[c] = last[target[c]] ? ONE : ZERO;
+	}
+
+	auto start = chrono::steady_clock::now();
+	{
+		ofstream VCDFile("bench_old.vcd");
+		vector<string> signalIDs(nodeCnt);
+		for (int i = 0; i < nodeCnt; i++) {
+			signalIDs[i] = "s" + to_string(i + 1);
+			VCDFile << "$var wire 1 " << signalIDs[i] << " " << nodes[i]->name << " $end\n";
+		}
+		for (int c = 0; c < changeCnt; c++) {
+			VCDFile << "#" << c/8 << "\n";
+			VCDFile << (value[c] == ONE ? "1" : "0") << signalIDs[target[c]] << "\n";
+		}
+	}
+	double old = SecondsSince(start);
+	start = chrono::steady_clock::now();
+	VCDWriter VCDFile;
+	VCDFile.Open("bench_new.vcd", "DigiSim Benchmark", nodes);
+	VCDFile.DumpVars(nodes);
+	for (int c = 0; c < changeCnt; c++) {
+		VCDFile.Write(target[c], value[c], c/8);
+	}
+	VCDFile.Close();
+	double now = SecondsSince(start);
+	printf("%d changes on %d Nodes\n", changeCnt, nodeCnt);
+	printf("  ofstream per event   %.3f s  %6.1f M changes/s  %6.1f MB\n", old, changeCnt/old/1e6, 
+	       filesystem::file_size("bench_old.vcd")/1e6);
+	printf("  VCDWriter            %.3f s  %6.1f M changes/s  %6.1f MB\n", now, changeCnt/now/1e6, 
+	       filesystem::file_size("bench_new.vcd")/1e6);
+	remove("bench_old.vcd");
+	remove("bench_new.vcd");
+	for (Node* node : nodes) {
+		delete node;
+	}
+
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteWaveformBenchFiles(netlist, stimulus);
+	double timing = RunTimingQuietly(netlist, stimulus, WaveformOptions());
+	printf("timing simulation, 100000 gates, 5000 input changes: %.3f s, %.1f MB waveform\n", timing, 
+	       filesystem::file_size("TimingSimOutput.vcd")/1e6);
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("TimingSimOutput.vcd");
+}
+
+// Asynchronous waveform benchmark: writes 4M Node changes (as in BenchVCD) and runs a timing simulation, each with 
+// the VCD formatted and written on the simulator thread and on a writer thread, and reports the simulator thread's 
+// time and the part of it spent stalled on a full ring. Checks both waveforms are the same. 
+void BenchAsyncWaveform() {
+	int nodeCnt = 100000, changeCnt = 4000000;
+	vector<Node*> nodes;
+	for (int i = 0; i < nodeCnt; i++) {
+		nodes.push_back(new Node("Node" + to_string(i), i));
+	}
+	mt19937 rng(14);
+	vector<int> target(changeCnt);
+	vector<LogicValue> value(changeCnt);
+	for (int c = 0; c < changeCnt; c++) {
+		target[c] = rng() % nodeCnt;
+		value[c] = (rng() % 2) ? ONE : ZERO;
+	}
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteWaveformBenchFiles(netlist, stimulus);
+
+	string waveform[2];
+	printf("                      changes (s)  stalled (s)   timing sim (s)  stalled (s)\n");
+	for (int async = 0; async < 2; async++) {
+		WaveformOptions options;
+		options.async = async;
+		auto start = chrono::steady_clock::now();
+		VCDWriter VCDFile;
+		VCDFile.SetOptions(options);
+		VCDFile.Open("bench_waveform.vcd", "DigiSim Benchmark", nodes);
+		VCDFile.DumpVars(nodes);
+		for (int c = 0; c < changeCnt; c++) {
+			VCDFile.Write(target[c], value[c], c/8);
+		}
+		VCDFile.Close();
+		double changes = SecondsSince(start);
+
+		double stall;
+		double timing = RunTimingQuietly(netlist, stimulus, options, &stall);
+		waveform[async] = FileContents("TimingSimOutput.vcd");
+		printf("  %-18s  %10.3f  %11.3f   %14.3f  %11.3f\n", async ? "writer thread" : "simulator thread", changes, 
+		       VCDFile.StallSeconds(), timing, stall);
+	}
+	if (waveform[0] != waveform[1]) {
+		printf("  WAVEFORMS DIFFER\n");
+	}
+	for (Node* node : nodes) {
+		delete node;
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("bench_waveform.vcd");
+	remove("TimingSimOutput.vcd");
+}
+
+// This helper Function returns the value changes of a VCD file listed by Node: each identifier (in order) followed 
+// by its changes as "time value" lines, in file order. A compressed waveform keeps the changes of each Node in order 
+// but not the order between Nodes within a time step, so a VCD converted back from it is compared with the original 
+// this way. 
+string VCDChangesByNode(string file) {
+	MappedFile VCDFile(file);
+	string_view text = VCDFile.Text();
+	map<string_view, string> nodes;
+	string_view time = "0";
+	bool dumping = false; // past $enddefinitions
+	for (size_t pos = 0, end; pos < text.size(); pos = end + 1) {
+		end = text.find('\n', pos);
+		end = (end == string_view::npos) ? text.size() : end;
+		string_view line = text.substr(pos, end - pos);
+		if (line.compare(0, 15, "$enddefinitions") == 0) {
+			dumping = true;
+		}
+		else if (dumping && !line.empty() && line[0] == '#') {
+			time = line.substr(1);
+		}
+		else if (dumping && !line.empty() && (line[0] == '0' || line[0] == '1' || line[0] == 'x')) {
+			string& changes = nodes[line.substr(1)];
+			changes.append(time.data(), time.size());
+			changes += ' ';
+			changes += line[0];
+			changes += '\n';
+		}
+	}
+	string changes;
+	for (const auto& node : nodes) {
+		changes.append(node.first.data(), node.first.size());
+		changes += '\n';
+		changes += node.second;
+	}
+	return changes;
+}
+
+// Compressed waveform benchmark: runs long clocked timing simulations of a small pipelined netlist like test5 (20 
+// gates, 4 DFFs) and of a larger synthetic synchronous netlist, and a timing simulation of a large synthetic 
+// netlist, writing a VCD and a compressed waveform, and reports the run times, file sizes and bytes per value 
+// change. Each compressed waveform is converted back to VCD and compared with the VCD Node by Node (see 
+// VCDChangesByNode). 
+void BenchCompressedWaveform() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	printf("%-14s %9s  %8s %11s %9s  %8s %11s %9s  %6s  %s\n", "", "changes", "VCD (s)", "VCD (MB)", "B/change", 
+	       "DSW (s)", "DSW (MB)", "B/change", "ratio", "round trip");
+	for (int run = 0; run < 3; run++) {
+		if (run == 0) {
+			WriteSyntheticSequentialNetlist(netlist, 20, 4, 8, 14);
+			WriteSyntheticClockedStimulus(stimulus, 8, 200000, 2, 15);
+		}
+		else if (run == 1) {
+			WriteSyntheticSequentialNetlist(netlist, 5000, 500, 100, 14);
+			WriteSyntheticClockedStimulus(stimulus, 100, 10000, 4, 15);
+		}
+		else {
+			WriteWaveformBenchFiles(netlist, stimulus);
+		}
+		double seconds[2];
+		for (int dsw = 0; dsw < 2; dsw++) {
+			WaveformOptions options;
+			options.compressed = dsw;
+			seconds[dsw] = RunTimingQuietly(netlist, stimulus, options);
+		}
+		ConvertWaveformToVCD("TimingSimOutput.dsw", "bench_roundtrip.vcd");
+		MappedFile VCDFile("TimingSimOutput.vcd");
+		TextScanner lines(VCDFile.Text());
+		long long changeCnt = 0;
+		bool dumping = true;
+		while (lines.NextLine()) {
+			string_view line = lines.Token();
+			dumping = dumping && line != "$end";
+			changeCnt += !dumping && !line.empty() && (line[0] == '0' || line[0] == '1');
+		}
+		double vcdSize = filesystem::file_size("TimingSimOutput.vcd"), dswSize = filesystem::file_size("TimingSimOutput.dsw");
+		printf("%-14s %9lld  %8.3f %11.2f %9.2f  %8.3f %11.3f %9.3f  %5.1fx  %s\n", 
+		       (run == 0) ? "test5-style" : (run == 1) ? "clocked" : "100k gates", 
+		       changeCnt, seconds[0], vcdSize/1e6, vcdSize/changeCnt, seconds[1], dswSize/1e6, dswSize/changeCnt, 
+		       vcdSize/dswSize, (VCDChangesByNode("TimingSimOutput.vcd") == VCDChangesByNode("bench_roundtrip.vcd")) ? 
+		       "same changes" : "DIFFERS");
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("TimingSimOutput.vcd");
+	remove("TimingSimOutput.dsw");
+	remove("bench_roundtrip.vcd");
+}
+
+// Selective dumping benchmark: runs a timing simulation of a large synthetic netlist dumping every Node, only the 
+// primary outputs, and only the primary outputs within a window of a tenth of the run, and reports the run time, 
+// the Nodes declared and the VCD size of each. 
+void BenchDump() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteWaveformBenchFiles(netlist, stimulus);
+	const char* names[3] = {"all Nodes", "@outputs", "@outputs window"};
+	printf("%-16s %9s  %8s %9s\n", "", "Nodes", "time (s)", "VCD (MB)");
+	for (int run = 0; run < 3; run++) {
+		WaveformOptions options;
+		if (run > 0) {
+			options.dumpPatterns.push_back("@outputs");
+		}
+		if (run == 2) {
+			options.dumpWindows.push_back(make_pair(20000LL, 25000LL));
+		}
+		double seconds = RunTimingQuietly(netlist, stimulus, options);
+		MappedFile VCDFile("TimingSimOutput.vcd");
+		TextScanner lines(VCDFile.Text());
+		long long nodeCnt = 0;
+		while (lines.NextLine()) {
+			nodeCnt += lines.Token() == "$var";
+		}
+		printf("%-16s %9lld  %8.3f %9.2f\n", names[run], nodeCnt, seconds, filesystem::file_size("TimingSimOutput.vcd")/1e6);
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("TimingSimOutput.vcd");
+}
+
+// Waveform database benchmark: runs a timing simulation of a large synthetic netlist with and without recording a 
+// waveform database, then reports the database size, the time to map it back in, and the rate of value-at-time 
+// and toggle-count queries at random Nodes and times, against the time to read the VCD through once. The query 
+// answers are checked by --test (see TestWaveformDatabase). 
+void BenchWaveformDatabase() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteWaveformBenchFiles(netlist, stimulus);
+	double seconds[2];
+	for (int record = 0; record < 2; record++) {
+		WaveformOptions options;
+		options.database = record;
+		seconds[record] = RunTimingQuietly(netlist, stimulus, options);
+	}
+
+	auto start = chrono::steady_clock::now();
+	WaveformDatabase db;
+	bool loaded = db.Load("TimingSimOutput.wdb");
+	double loadSeconds = SecondsSince(start);
+	if (!loaded || db.Nodes() == 0) {
+		printf("could not load TimingSimOutput.wdb\n");
+		return;
+	}
+	long long endTime = 0;
+	for (int n = 0; n < db.Nodes(); n++) {
+		WaveformSpan all = db.Transitions(n, 0, numeric_limits<long long>::max());
+		endTime = max(endTime, all.count ? all.times[all.count - 1] : 0);
+	}
+	const int queryCnt = 1000000;
+	mt19937_64 rng(21);
+	vector<pair<int, long long>> queries(queryCnt);
+	for (pair<int, long long>& q : queries) {
+		q = make_pair((int)(rng() % db.Nodes()), (long long)(rng() % (endTime + 1)));
+	}
+	long long ones = 0, toggles = 0;
+	start = chrono::steady_clock::now();
+	for (const pair<int, long long>& q : queries) {
+		ones += db.ValueAt(q.first, q.second) == '1';
+	}
+	double valueSeconds = SecondsSince(start);
+	start = chrono::steady_clock::now();
+	for (const pair<int, long long>& q : queries) {
+		toggles += db.ToggleCount(q.first, q.second, q.second + endTime/10);
+	}
+	double toggleSeconds = SecondsSince(start);
+
+	// Without the database, a value-at-time query reads the VCD up to that time
+	const int scanCnt = 20;
+	long long scanOnes = 0;
+	start = chrono::steady_clock::now();
+	for (int k = 0; k < scanCnt; k++) {
+		const pair<int, long long>& q = queries[k];
+		string id;
+		for (size_t i = q.first; id.empty() || i > 0; i /= 94) {
+			id += (char)('!' + i % 94);
+		}
+		MappedFile VCDFile("TimingSimOutput.vcd");
+		string_view text = VCDFile.Text();
+		long long time = 0;
+		char value = 'x';
+		for (size_t pos = 0, end; pos < text.size() && time <= q.second; pos = end + 1) {
+			end = text.find('\n', pos);
+			end = (end == string_view::npos) ? text.size() : end;
+			string_view line = text.substr(pos, end - pos);
+			if (!line.empty() && line[0] == '#') {
+				ParseNumber(line.substr(1), time);
+			}
+			else if (!line.empty() && (line[0] == '0' || line[0] == '1') && line.substr(1) == id) {
+				value = line[0];
+			}
+		}
+		scanOnes += value == '1';
+	}
+	double scanSeconds = SecondsSince(start);
+
+	printf("timing simulation %.3f s, %.3f s recording the database\n", seconds[0], seconds[1]);
+	printf("VCD %.2f MB, database %.2f MB (%zu values, %d Nodes) mapped in %.6f s\n", 
+	       filesystem::file_size("TimingSimOutput.vcd")/1e6, filesystem::file_size("TimingSimOutput.wdb")/1e6, 
+	       db.Changes(), db.Nodes(), loadSeconds);
+	printf("value-at-time reading the VCD:    %12.3f us/query  (%.1f%% ones)\n", scanSeconds/scanCnt*1e6, 
+	       100.0*scanOnes/scanCnt);
+	printf("value-at-time from the database:  %12.3f us/query  (%.1f%% ones)\n", valueSeconds/queryCnt*1e6, 
+	       100.0*ones/queryCnt);
+	printf("toggle-count from the database:   %12.3f us/query  (%.2f toggles per query)\n", 
+	       toggleSeconds/queryCnt*1e6, (double)toggles/queryCnt);
+	db = WaveformDatabase();
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("TimingSimOutput.vcd");
+	remove("TimingSimOutput.wdb");
+}
+
+// Event scheduler benchmark: runs the same timing simulation with the heap and the timing wheel scheduler and 
+// reports executed Events per second. 
+void BenchSchedulers() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteSyntheticNetlist(netlist, 100000, 5000, 2);
+	WriteSyntheticStimulus(stimulus, 5000, 50000, 20, 3);
+	const char* names[2] = {"heap", "wheel"};
+	SchedulerType types[2] = {HEAP_SCHEDULER, WHEEL_SCHEDULER};
+	for (int i = 0; i < 2; i++) {
+		Circuit *C = new Circuit(netlist, false);
+		C->SetScheduler(types[i]);
+		auto start = chrono::steady_clock::now();
+		C->TimingSimulation(stimulus);
+		double seconds = SecondsSince(start);
+		printf("%-6s %lld events in %.3f s = %.0f events/s\n", names[i], C->EventsExecuted(), seconds, 
+			   C->EventsExecuted()/seconds);
+		delete C;
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("TimingSimOutput.vcd");
+}
+
+// Stimulus streaming benchmark: runs a timing simulation of a small netlist with a long stimulus and reports the 
+// largest number of Events queued at once, which should be set by the activity in flight rather than the stimulus 
+// length (see EventQueue::Attach), and the peak resident memory. 
+void BenchStimulus() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteSyntheticNetlist(netlist, 2000, 200, 18);
+	printf("changes    stimulus (kB)  time (s)   events       peak queue  peak resident (kB)\n");
+	for (int changes = 250000; changes <= 2000000; changes *= 2) {
+		WriteSyntheticStimulus(stimulus, 200, changes, 10, 19);
+		Circuit *C = new Circuit(netlist, false);
+		auto start = chrono::steady_clock::now();
+		C->TimingSimulation(stimulus);
+		double seconds = SecondsSince(start);
+		printf("%-10d %-14ld %-10.3f %-12lld %-11lld %ld\n", changes, (long)(filesystem::file_size(stimulus) / 1024), 
+		       seconds, C->EventsExecuted(), C->QueuePeak(), ResidentKB("VmHWM:"));
+		delete C;
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("TimingSimOutput.vcd");
+}
+
+// This Function times the event-driven and levelized Functional Simulations on the same synthetic netlist. 
+void BenchFunctional() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteSyntheticNetlist(netlist, 100000, 5000, 4);
+	WriteSyntheticStimulus(stimulus, 5000, 50000, 20, 5);
+	const char* names[2] = {"event", "levelized"};
+	for (int i = 0; i < 2; i++) {
+		Circuit *C = new Circuit(netlist, false);
+		auto start = chrono::steady_clock::now();
+		if (i == 0) {
+			C->FunctionalSimulation(stimulus);
+		}
+		else {
+			C->FunctionalSimulationLevelized(stimulus);
+		}
+		printf("%-10s %.3f s\n", names[i], SecondsSince(start));
+		delete C;
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("FunctionalSimOutput.vcd");
+}
+
+// This Function compares the vectors/sec of one Functional Simulation per test vector (how FaultVectorGenerator 
+// used to test vectors) against bit-parallel pattern simulation with each pattern kernel the CPU supports. 
+void BenchPatterns() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteSyntheticNetlist(netlist, 20000, 500, 6);
+	Circuit *C = new Circuit(netlist, false);
+	vector<Node*> inputs = C->PatternInputs();
+	mt19937_64 rng(7);
+
+	int vectorCnt = 20;
+	auto start = chrono::steady_clock::now();
+	for (int v = 0; v < vectorCnt; v++) {
+		ofstream Vector(stimulus);
+		for (size_t i = 0; i < inputs.size(); i++) {
+			Vector << 0 << " " << inputs[i]->name << " " << (rng() & 1) << endl;
+		}
+		Vector.close();
+		C->FunctionalSimulation(stimulus);
+	}
+	double seconds = SecondsSince(start);
+	printf("%-10s %d vectors in %.3f s = %.0f vectors/s\n", "event", vectorCnt, seconds, vectorCnt/seconds);
+
+	int blockCnt = 2000;
+	vector<uint64_t> inputWords(blockCnt * inputs.size());
+	for (size_t i = 0; i < inputWords.size(); i++) {
+		inputWords[i] = rng();
+	}
+	const char* names[3] = {"scalar", "avx2", "avx512"};
+	PatternKernel kernels[3] = {SCALAR_KERNEL, AVX2_KERNEL, AVX512_KERNEL};
+	for (int k = 0; k < 3; k++) {
+		if (!PatternKernelSupported(kernels[k])) {
+			printf("%-10s not supported by this CPU\n", names[k]);
+			continue;
+		}
+		C->SetPatternKernel(kernels[k]);
+		start = chrono::steady_clock::now();
+		vector<uint64_t> outputWords = C->SimulatePatterns(inputWords);
+		seconds = SecondsSince(start);
+		printf("%-10s %d vectors in %.3f s = %.0f vectors/s\n", names[k], 64*blockCnt, seconds, 64*blockCnt/seconds);
+	}
+
+	delete C;
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("FunctionalSimOutput.vcd");
+}
+
+// This Function checks that memory use stays flat over a long simulation. The same stimulus is run through the 
+// Timing Simulation of one Circuit round after round (the Circuit keeps its state, so each round carries on from 
+// the last), and the resident memory is printed after every round. 
+void BenchSoak() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteSyntheticNetlist(netlist, 20000, 1000, 8);
+	WriteSyntheticStimulus(stimulus, 1000, 20000, 20, 9);
+	Circuit *C = new Circuit(netlist, false);
+	long startKB = 0;
+	int roundCnt = 10;
+	for (int r = 1; r <= roundCnt; r++) {
+		C->TimingSimulation(stimulus);
+		long rssKB = ResidentKB();
+		startKB = (r == 1) ? rssKB : startKB;
+		printf("round %2d  %lld events  RSS %ld kB\n", r, C->EventsExecuted(), rssKB);
+	}
+	printf("RSS growth after round 1: %ld kB\n", ResidentKB() - startKB);
+	delete C;
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("TimingSimOutput.vcd");
+}
+
+// This Function times the compiled Functional Simulation against the levelized one on the same synthetic netlist. 
+// The first compiled run generates and compiles the module (cold cache), the second loads it from the cache. 
+void BenchCompiled() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteSyntheticNetlist(netlist, 5000, 500, 10);
+	WriteSyntheticStimulus(stimulus, 500, 200000, 20, 11);
+	Circuit *C = new Circuit(netlist, false);
+	string key = C->NativeKey();
+	remove(NativeModule::Path(key, ".so").c_str());
+	delete C;
+
+	const char* names[3] = {"levelized", "compiled (cold cache)", "compiled (warm cache)"};
+	for (int i = 0; i < 3; i++) {
+		C = new Circuit(netlist, false);
+		auto start = chrono::steady_clock::now();
+		if (i == 0) {
+			C->FunctionalSimulationLevelized(stimulus);
+		}
+		else {
+			C->FunctionalSimulationCompiled(stimulus);
+		}
+		printf("%-22s %.3f s\n", names[i], SecondsSince(start));
+		delete C;
+	}
+	remove(NativeModule::Path(key, ".so").c_str());
+	remove(NativeModule::Path(key, ".cpp").c_str());
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("FunctionalSimOutput.vcd");
+}
+
+// This Function times the cycle-based Functional Simulation (with and without the per-cycle waveform) against the 
+// event-driven and levelized ones on a synthetic synchronous netlist, and checks the cycle-based runs end with the 
+// same output values as the levelized simulation. 
+void BenchCycle() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	WriteSyntheticSequentialNetlist(netlist, 5000, 500, 100, 14);
+	WriteSyntheticClockedStimulus(stimulus, 100, 10000, 4, 15);
+	const char* names[4] = {"event", "levelized", "cycle (per-cycle VCD)", "cycle (no VCD)"};
+	vector<tuple<string,int>> reference;
+	double eventSeconds = 0;
+	for (int i = 0; i < 4; i++) {
+		Circuit *C = new Circuit(netlist, false);
+		auto start = chrono::steady_clock::now();
+		if (i == 0) {
+			C->FunctionalSimulation(stimulus);
+		}
+		else if (i == 1) {
+			C->FunctionalSimulationLevelized(stimulus);
+		}
+		else {
+			C->FunctionalSimulationCycle(stimulus, i == 2);
+		}
+		double seconds = SecondsSince(start);
+		vector<tuple<string,int>> outputs = C->CircuitOutputs();
+		sort(outputs.begin(), outputs.end());
+		reference = (i == 1) ? outputs : reference;
+		eventSeconds = (i == 0) ? seconds : eventSeconds;
+		printf("%-22s %.3f s  speedup %.1fx", names[i], seconds, eventSeconds/seconds);
+		printf((i < 2) ? "\n" : "  outputs %s\n", (outputs == reference) ? "identical" : "DIFFER");
+		delete C;
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("FunctionalSimOutput.vcd");
+}
+
+// This helper Function returns the value changes of a VCD file written by DigiSim with every identifier replaced 
+// by its signal name. The identifiers depend on the order of the Circuit's Node set, which can differ between two 
+// Circuit objects built from the same netlist, so waveforms of different Circuits are compared this way. 
+string VCDChangesByName(string file) {
+	ifstream VCDFile(file);
+	unordered_map<string, string> names;
+	string line, changes;
+	bool dumping = false;
+	while (getline(VCDFile, line)) {
+		stringstream linestream(line);
+		string keyword, type, width, id, name;
+		if (line.compare(0, 4, "$var") == 0) {
+			linestream >> keyword >> type >> width >> id >> name;
+			names[id] = name;
+		}
+		else if (line == "$dumpvars" || line == "$end") {
+			dumping = (line == "$dumpvars"); // the initial values are all 0
+		}
+		else if (!dumping && line[0] == '#') {
+			changes += line + "\n";
+		}
+		else if (!dumping && (line[0] == '0' || line[0] == '1') && names.count(line.substr(1))) {
+			changes += line[0] + names[line.substr(1)] + "\n";
+		}
+	}
+	return changes;
+}
+
+// This Function times a long event-driven Functional Simulation of a small synchronous netlist whose clock is a 
+// .CLOCK source against the same simulation with every clock edge listed in the stimulus file, and checks both end 
+// in the same state. The clocked run goes first, so the growth of the peak resident memory is the cost of queueing 
+// the listed edges up front. 
+void BenchClock() {
+	string netlist = "bench_netlist.txt", stimulus = "bench_input.txt";
+	const int cycleCnt = 1000000;
+	WriteSyntheticSequentialNetlist(netlist, 100, 10, 8, 16);
+	ofstream(netlist, ios::app) << "CLK .CLOCK 1000 50 0 0 " << cycleCnt*1000LL << "\n";
+	ofstream(stimulus).close();
+	const char* names[2] = {".CLOCK source", "stimulus edges"};
+	vector<tuple<string,int>> reference;
+	for (int i = 0; i < 2; i++) {
+		if (i == 1) {
+			WriteSyntheticSequentialNetlist(netlist, 100, 10, 8, 16);
+			WriteSyntheticClockedStimulus(stimulus, 8, cycleCnt, 0, 17);
+		}
+		long stimulusKB = filesystem::file_size(stimulus) / 1024;
+		auto start = chrono::steady_clock::now();
+		Circuit *C = new Circuit(netlist, false);
+		C->FunctionalSimulation(stimulus);
+		double seconds = SecondsSince(start);
+		long peakKB = ResidentKB("VmHWM:");
+		vector<tuple<string,int>> outputs = C->CircuitOutputs();
+		sort(outputs.begin(), outputs.end());
+		reference = (i == 0) ? outputs : reference;
+		printf("%-15s %.3f s  stimulus %ld kB  peak resident %ld kB", names[i], seconds, stimulusKB, peakKB);
+		printf((i == 0) ? "\n" : "  outputs %s\n", (outputs == reference) ? "identical" : "DIFFER");
+		delete C;
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("FunctionalSimOutput.vcd");
+}
+
+// This Function runs the named benchmark. Returns 0 on success and 1 if the name is unknown. 
+int RunBenchmark(string name) {
+	if (name == "load") {
+		BenchNetlistLoad();
+	}
+	else if (name == "events") {
+		BenchSchedulers();
+	}
+	else if (name == "functional") {
+		BenchFunctional();
+	}
+	else if (name == "patterns") {
+		BenchPatterns();
+	}
+	else if (name == "soak") {
+		BenchSoak();
+	}
+	else if (name == "compiled") {
+		BenchCompiled();
+	}
+	else if (name == "cycle") {
+		BenchCycle();
+	}
+	else if (name == "clock") {
+		BenchClock();
+	}
+	else if (name == "stimulus") {
+		BenchStimulus();
+	}
+	else if (name == "parser") {
+		BenchParser();
+	}
+	else if (name == "images") {
+		BenchNetlistImages();
+	}
+	else if (name == "faults") {
+		BenchFaultMachines();
+	}
+	else if (name == "batch") {
+		BenchBatch();
+	}
+	else if (name == "vcd") {
+		BenchVCD();
+	}
+	else if (name == "async") {
+		BenchAsyncWaveform();
+	}
+	else if (name == "dsw") {
+		BenchCompressedWaveform();
+	}
+	else if (name == "dump") {
+		BenchDump();
+	}
+	else if (name == "wdb") {
+		BenchWaveformDatabase();
+	}
+	else {
+		cerr << "Unknown benchmark " << name << " (available: load, events, functional, patterns, soak, compiled, "
+		     << "cycle, clock, stimulus, parser, images, faults, batch, vcd, async, dsw, dump, wdb)" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+
+// ----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------- REGRESSION TESTS ------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------------------
+// The functions below implement the built-in regression tests, run from the terminal with "digisim --test". Like the 
+// benchmarks, they write their netlists and stimulus files to the directory the program is run from and remove them 
+// when finished. Each test prints PASS or FAIL and why. 
+
+// This helper Function writes a stimulus file for a synthetic netlist in bursts: burstCnt times, drawn 0-600 time 
+// units apart (so bursts land while earlier gate updates are still pending), each changing 1 to inputCnt random 
+// primary inputs at the same time (an input may change more than once in a burst). 
+void WriteBurstStimulus(string file, int inputCnt, int burstCnt, unsigned seed) {
+	mt19937 rng(seed);
+	ofstream Stimulus(file);
+	int time = 0;
+	for (int b = 0; b < burstCnt; b++) {
+		time += rng() % 601;
+		int changeCnt = 1 + rng() % inputCnt;
+		for (int i = 0; i < changeCnt; i++) {
+			Stimulus << time << " In" << rng() % inputCnt << " " << rng() % 2 << "\n";
+		}
+	}
+	Stimulus.close();
+}
+
+// This helper Function writes random test case seed: a 20 gate netlist on 5 inputs (see WriteSyntheticNetlist) driven
+// by 12 bursts of same-time input changes (see WriteBurstStimulus). 
+void WriteRandomTestCase(string netlist, string stimulus, int seed) {
+	WriteSyntheticNetlist(netlist, 20, 5, seed);
+	WriteBurstStimulus(stimulus, 5, 12, seed);
+}
+
+// This helper Function makes a Circuit of the netlist that writes test_timing.vcd and test_functional.vcd, and calls 
+// run on it with cout captured. Returns what was written to cout (progress lines and setup/hold violation reports). 
+string RunTestCircuit(string netlist, const function<void(Circuit&)>& run) {
+	ostringstream console;
+	QuietConsole quiet(&console);
+	Circuit C(netlist, false);
+	C.SetOutputFiles("test_timing.vcd", "test_functional.vcd");
+	run(C);
+	return console.str();
+}
+
+// This helper Function returns an empty string if the output Nodes of C hold the settled values of its inputs 
+// (computed by pattern simulation), or the names of the outputs that do not. 
+string UnsettledOutputs(Circuit& C) {
+	vector<Node*> ins = C.PatternInputs(), outs = C.PatternOutputs();
+	vector<uint64_t> inputWords;
+	for (Node* node : ins) {
+		inputWords.push_back((node->CurValue == ONE) ? 1 : 0);
+	}
+	vector<uint64_t> settled = C.SimulatePatterns(inputWords);
+	string wrong;
+	for (size_t o = 0; o < outs.size(); o++) {
+		if ((outs[o]->CurValue == ONE) != (settled[o] & 1)) {
+			wrong += " " + outs[o]->name;
+		}
+	}
+	return wrong;
+}
+
+// Test: gates whose inputs change at the same time settle on the value of their final inputs in every simulator. 
+// When several inputs of a gate change at one time, the gate is calculated, cancelled (see EventQueue::Delete) and 
+// recalculated within the time step; the Timing Simulation and the event-driven Functional Simulation must leave 
+// the gate output where its final inputs put it. Runs a 4-input XOR whose inputs change together twice, 5 time 
+// units apart, and random netlists driven by bursts of same-time input changes. 
+bool TestSameTimeInputs() {
+	string netlist = "test_netlist.txt", stimulus = "test_input.txt";
+	const char* names[3] = {"timing", "functional (event)", "functional (levelized)"};
+	for (int seed = 0; seed <= 200; seed++) {
+		if (seed == 0) {
+			ofstream Netlist(netlist);
+			Netlist << "G .XOR 20 14 I0 I1 I2 I3\n";
+			Netlist.close();
+			ofstream Stimulus(stimulus);
+			Stimulus << "0 I0 1\n0 I1 0\n0 I2 0\n" << "100 I3 0\n100 I0 0\n100 I3 1\n100 I2 0\n100 I1 1\n"
+			         << "105 I1 0\n105 I2 1\n105 I0 0\n";
+			Stimulus.close();
+		}
+		else {
+			WriteRandomTestCase(netlist, stimulus, seed);
+		}
+		for (int run = 0; run < 3; run++) {
+			string wrong;
+			RunTestCircuit(netlist, [&](Circuit& C) {
+				if (run == 0) {
+					C.TimingSimulation(stimulus);
+				}
+				else {
+					C.FunctionalSimulation(stimulus, (run == 1) ? EVENT_ENGINE : LEVELIZED_ENGINE, false);
+				}
+				wrong = UnsettledOutputs(C);
+			});
+			if (!wrong.empty()) {
+				printf("FAIL same-time inputs: %s simulation of netlist %d leaves%s unsettled\n", names[run], seed, 
+				       wrong.c_str());
+				return false;
+			}
+		}
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("test_timing.vcd");
+	remove("test_functional.vcd");
+	printf("PASS same-time inputs\n");
+	return true;
+}
+
+// This helper Function flips the gate type of gate N0 of a synthetic netlist (AND to NAND, NAND to AND and so on), 
+// which changes its logic but not its Node, gate or DFF counts. 
+void InvertFirstGate(string netlist) {
+	string text = FileContents(netlist);
+	size_t type = text.find(" .", text.find("\nN0 ")) + 2;
+	if (text[type] == 'N') {
+		text.erase(type, 1);
+	}
+	else {
+		text.insert(type + (text[type] == 'X'), "N");
+	}
+	ofstream(netlist) << text;
+}
+
+// Test: the event-driven, levelized and compiled Functional Simulations write the same FunctionalSimOutput.vcd, byte 
+// for byte. Runs random netlists driven by bursts of same-time input changes and random synchronous netlists driven 
+// by a clock through the event-driven engine (with both Event Queue schedulers), the levelized engine and, on the 
+// first few netlists (each is compiled with g++), the compiled engine, and compares each waveform with the levelized
+// one. The compiled engine is skipped where netlists cannot be compiled. Then edits a compiled netlist without 
+// changing its shape, and checks the edited netlist is compiled again rather than given the cached module of the 
+// original, while the original still loads from the cache. 
+bool TestEngineWaveforms() {
+	string netlist = "test_netlist.txt", stimulus = "test_input.txt";
+	const char* names[3] = {"event-driven (heap)", "event-driven (wheel)", "compiled"};
+	bool compiled = true; // cleared if netlists cannot be compiled here
+	vector<string> keys;  // cache keys of the modules compiled by the test
+	for (int seed = 1; seed <= 205; seed++) {
+		if (seed > 200) {
+			WriteSyntheticSequentialNetlist(netlist, 40, 6, 5, seed);
+			WriteSyntheticClockedStimulus(stimulus, 5, 20, 3, seed);
+		}
+		else {
+			WriteRandomTestCase(netlist, stimulus, seed);
+		}
+		bool compile = compiled && (seed <= 5 || seed > 200);
+		if (compile) {
+			RunTestCircuit(netlist, [&](Circuit& C) {
+				keys.push_back(C.NativeKey());
+				remove(NativeModule::Path(keys.back(), ".so").c_str());
+				compiled = C.LoadNativeModule();
+			});
+			compile = compiled;
+			if (!compiled) {
+				printf("note: netlists cannot be compiled here, engine waveforms skips the compiled engine\n");
+			}
+		}
+		string waveforms[4];
+		for (int run = 0; run < 4; run++) {
+			if (run == 2 && !compile) {
+				continue;
+			}
+			string console = RunTestCircuit(netlist, [&](Circuit& C) {
+				C.SetScheduler((run == 1) ? WHEEL_SCHEDULER : HEAP_SCHEDULER);
+				C.FunctionalSimulation(stimulus, (run == 3) ? LEVELIZED_ENGINE : (run == 2) ? COMPILED_ENGINE : 
+				                       EVENT_ENGINE, false);
+			});
+			if (run == 2 && console.find("Cannot compile") != string::npos) {
+				printf("FAIL engine waveforms: the compiled module of netlist %d does not load\n", seed);
+				return false;
+			}
+			waveforms[run] = FileContents("test_functional.vcd");
+		}
+		for (int run = 0; run < 3; run++) {
+			if ((run < 2 || compile) && waveforms[run] != waveforms[3]) {
+				printf("FAIL engine waveforms: %s and levelized waveforms of netlist %d differ\n", names[run], seed);
+				return false;
+			}
+		}
+	}
+
+	// the last netlist is compiled and cached: edit it, then run the edited netlist and the original through the 
+	// compiled engine, which must compile the first and load the second from the cache
+	if (compiled) {
+		for (int edit = 1; edit >= 0; edit--) {
+			InvertFirstGate(netlist);
+			string waveform[2], console;
+			for (int run = 0; run < 2; run++) {
+				string output = RunTestCircuit(netlist, [&](Circuit& C) {
+					if (run == 1) {
+						keys.push_back(C.NativeKey());
+					}
+					C.FunctionalSimulation(stimulus, run ? COMPILED_ENGINE : LEVELIZED_ENGINE, false);
+				});
+				console = run ? output : console;
+				waveform[run] = FileContents("test_functional.vcd");
+			}
+			if (waveform[0] != waveform[1] || (console.find("Compiling netlist") != string::npos) != (edit == 1)) {
+				printf("FAIL engine waveforms: the compiled engine runs a stale cached module after a netlist edit\n");
+				return false;
+			}
+		}
+	}
+	for (const string& key : keys) {
+		remove(NativeModule::Path(key, ".so").c_str());
+		remove(NativeModule::Path(key, ".cpp").c_str());
+	}
+	error_code ec;
+	filesystem::remove("digisim_cache", ec); // only if the test left it empty
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("test_functional.vcd");
+	printf("PASS engine waveforms\n");
+	return true;
+}
+
+// Test: a compressed waveform converted back to VCD (--to-vcd) holds the same changes of every Node as the VCD of the
+// same Timing Simulation. The changes of different Nodes within one time step may come back in another order, so the
+// waveforms are compared Node by Node (see VCDChangesByNode). Runs random netlists driven by bursts of input changes
+// and a synthetic synchronous netlist driven by a clock.
+bool TestCompressedWaveforms() {
+	string netlist = "test_netlist.txt", stimulus = "test_input.txt";
+	for (int seed = 1; seed <= 50; seed++) {
+		if (seed == 50) {
+			WriteSyntheticSequentialNetlist(netlist, 200, 20, 5, seed);
+			WriteSyntheticClockedStimulus(stimulus, 5, 100, 2, seed);
+		}
+		else {
+			WriteRandomTestCase(netlist, stimulus, seed);
+		}
+		for (int dsw = 0; dsw < 2; dsw++) {
+			RunTestCircuit(netlist, [&](Circuit& C) {
+				WaveformOptions options;
+				options.compressed = dsw;
+				C.SetWaveformOptions(options);
+				C.TimingSimulation(stimulus);
+			});
+		}
+		if (!ConvertWaveformToVCD("test_timing.dsw", "test_roundtrip.vcd") ||
+		    VCDChangesByNode("test_timing.vcd") != VCDChangesByNode("test_roundtrip.vcd")) {
+			printf("FAIL compressed waveforms: the waveform of netlist %d does not convert back to its VCD\n", seed);
+			return false;
+		}
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("test_timing.vcd");
+	remove("test_timing.dsw");
+	remove("test_roundtrip.vcd");
+	printf("PASS compressed waveforms\n");
+	return true;
+}
+
+// This helper Function returns the values of every Node of a VCD written by DigiSim at the end of each of the passed 
+// time steps (in increasing order): one line per time step with the Node values in Node name order, so the waveforms
+// of different Circuits and of simulations with different time steps can be compared. 
+string VCDValuesAt(string file, const vector<long long>& times) {
+	ifstream VCDFile(file);
+	map<string, string> names; // Node name -> identifier
+	string line;
+	while (getline(VCDFile, line) && line.compare(0, 15, "$enddefinitions") != 0) {
+		stringstream linestream(line);
+		string keyword, type, width, id, name;
+		if (line.compare(0, 4, "$var") == 0) {
+			linestream >> keyword >> type >> width >> id >> name;
+			names[name] = id;
+		}
+	}
+	unordered_map<string, int> position; // identifier -> position in the value line
+	int p = 0;
+	for (const auto& name : names) {
+		position[name.second] = p++;
+	}
+	string values(names.size(), 'x'), snapshots;
+	size_t t = 0;
+	while (getline(VCDFile, line)) {
+		if (!line.empty() && line[0] == '#') {
+			for (long long time = atoll(line.c_str() + 1); t < times.size() && times[t] < time; t++) {
+				snapshots += values + "\n";
+			}
+		}
+		else if (!line.empty() && (line[0] == '0' || line[0] == '1' || line[0] == 'x') && position.count(line.substr(1))) {
+			values[position[line.substr(1)]] = line[0];
+		}
+	}
+	for (; t < times.size(); t++) {
+		snapshots += values + "\n";
+	}
+	return snapshots;
+}
+
+// Test: the cycle-based Functional Simulation ends with the same output values as the levelized one, and with 
+// --dump-cycles its waveform holds the values of every Node the levelized waveform has at the end of each active 
+// clock edge and of the stimulus. Runs random synchronous netlists with their clock edges and input changes in the 
+// stimulus. 
+bool TestCycleEngine() {
+	string netlist = "test_netlist.txt", stimulus = "test_input.txt";
+	const int cycleCnt = 20;
+	vector<long long> edges;
+	for (int c = 0; c < cycleCnt; c++) {
+		edges.push_back(c*1000LL);
+	}
+	edges.push_back((cycleCnt - 1)*1000LL + 500); // the end of the stimulus
+	for (int seed = 1; seed <= 40; seed++) {
+		WriteSyntheticSequentialNetlist(netlist, 40, 6, 5, seed);
+		WriteSyntheticClockedStimulus(stimulus, 5, cycleCnt, 3, seed);
+		vector<tuple<string,int>> outputs[2];
+		string samples[2];
+		for (int run = 0; run < 2; run++) {
+			RunTestCircuit(netlist, [&](Circuit& C) {
+				C.FunctionalSimulation(stimulus, run ? CYCLE_ENGINE : LEVELIZED_ENGINE, true);
+				outputs[run] = C.CircuitOutputs();
+				sort(outputs[run].begin(), outputs[run].end());
+			});
+			samples[run] = VCDValuesAt("test_functional.vcd", edges);
+		}
+		if (outputs[1] != outputs[0]) {
+			printf("FAIL cycle engine: cycle-based and levelized outputs of netlist %d differ\n", seed);
+			return false;
+		}
+		if (samples[1] != samples[0]) {
+			printf("FAIL cycle engine: cycle-based waveform of netlist %d differs from the levelized one at a clock "
+			       "edge\n", seed);
+			return false;
+		}
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("test_functional.vcd");
+	printf("PASS cycle engine\n");
+	return true;
+}
+
+// Test: a Circuit reset between runs (see Circuit::Reset) simulates each input file like a new Circuit. Runs batches 
+// of random input files on random netlists and random DFF netlists with FunctionalSimulationBatch on 1 and 3 threads,
+// and checks every waveform and the summary against a new Circuit per input file. Then checks a Circuit with a 
+// stuck-at Node, reset after a run, against a new Circuit with the same stuck-at Node. 
+bool TestBatchReset() {
+	string netlist = "test_netlist.txt";
+	vector<string> inputFiles;
+	for (int r = 0; r < 6; r++) {
+		inputFiles.push_back("test_input" + to_string(r) + ".txt");
+	}
+	for (int seed = 1; seed <= 20; seed++) {
+		if (seed > 10) {
+			WriteSyntheticSequentialNetlist(netlist, 40, 6, 5, seed);
+		}
+		else {
+			WriteSyntheticNetlist(netlist, 20, 5, seed);
+		}
+		for (int r = 0; r < 6; r++) {
+			if (seed > 10) {
+				// every other file ends with the clock high, so a DFF not reset misses the next file's first edge
+				WriteSyntheticClockedStimulus(inputFiles[r], 5, 10, 3, 10*seed + r);
+				ofstream(inputFiles[r], ios::app) << ((r % 2) ? "10000 CLK 1\n" : "");
+			}
+			else {
+				WriteBurstStimulus(inputFiles[r], 5, 12, 10*seed + r);
+			}
+		}
+		string summary;
+		vector<string> waveforms;
+		for (const string& inputFile : inputFiles) {
+			RunTestCircuit(netlist, [&](Circuit& C) {
+				C.FunctionalSimulation(inputFile);
+				summary += BatchSummary(inputFile, C.PatternOutputs());
+			});
+			waveforms.push_back(FileContents("test_functional.vcd"));
+		}
+		for (int threadCnt = 1; threadCnt <= 3; threadCnt += 2) {
+			{
+				QuietConsole quiet;
+				FunctionalSimulationBatch(make_shared<const Netlist>(netlist, false), inputFiles, HEAP_SCHEDULER, 
+				                          EVENT_ENGINE, false, WaveformOptions(), threadCnt, "test_summary.txt");
+			}
+			bool same = FileContents("test_summary.txt") == summary;
+			for (size_t r = 0; r < inputFiles.size(); r++) {
+				same = same && FileContents(BatchOutputFile(r)) == waveforms[r];
+			}
+			if (!same) {
+				printf("FAIL batch reset: batch of netlist %d on %d threads differs from a new Circuit per run\n", seed, 
+				       threadCnt);
+				return false;
+			}
+		}
+
+		string stuckNode = (seed % 2) ? "In1" : "N3";
+		string reset, fresh;
+		RunTestCircuit(netlist, [&](Circuit& C) {
+			C.CreateStuckAt(stuckNode, ONE);
+			C.FunctionalSimulation(inputFiles[0]);
+			C.Reset();
+			C.FunctionalSimulation(inputFiles[1]);
+			reset = BatchSummary(inputFiles[1], C.PatternOutputs());
+		});
+		reset += FileContents("test_functional.vcd");
+		RunTestCircuit(netlist, [&](Circuit& C) {
+			C.CreateStuckAt(stuckNode, ONE);
+			C.FunctionalSimulation(inputFiles[1]);
+			fresh = BatchSummary(inputFiles[1], C.PatternOutputs());
+		});
+		fresh += FileContents("test_functional.vcd");
+		if (reset != fresh) {
+			printf("FAIL batch reset: netlist %d with %s stuck-at 1 differs after a reset from a new Circuit\n", seed, 
+			       stuckNode.c_str());
+			return false;
+		}
+	}
+	remove(netlist.c_str());
+	for (size_t r = 0; r < inputFiles.size(); r++) {
+		remove(inputFiles[r].c_str());
+		remove(BatchOutputFile(r).c_str());
+	}
+	remove("test_summary.txt");
+	remove("test_functional.vcd");
+	printf("PASS batch reset\n");
+	return true;
+}
+
+// This helper Function checks the value-at-time, toggle-count and transition queries of database db, Node n, against a
+// linear scan of the changes recorded for it (times in order, the first is its $dumpvars value) at every passed time 
+// and over ranges between them. Returns false on the first wrong answer. 
+bool CheckWaveformQueries(const WaveformDatabase& db, int n, const vector<pair<long long, char>>& changes, 
+                          const vector<long long>& queryTimes) {
+	for (long long time : queryTimes) {
+		char value = 'x';
+		for (const pair<long long, char>& change : changes) {
+			value = (change.first <= time) ? change.second : value;
+		}
+		if (db.ValueAt(n, time) != value) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < queryTimes.size(); i += 3) {
+		for (size_t j = 0; j < queryTimes.size(); j += 5) {
+			long long from = min(queryTimes[i], queryTimes[j]), to = max(queryTimes[i], queryTimes[j]);
+			WaveformSpan span = db.Transitions(n, from, to);
+			size_t first = 0, count = 0, toggles = 0;
+			for (size_t c = 0; c < changes.size(); c++) {
+				if (changes[c].first >= from && changes[c].first <= to) {
+					first = (count == 0) ? c : first;
+					count++;
+					toggles += (c > 0);
+				}
+			}
+			bool same = span.count == count && db.ToggleCount(n, from, to) == toggles;
+			for (size_t c = 0; same && c < count; c++) {
+				same = span.times[c] == changes[first + c].first && span.values[c] == changes[first + c].second;
+			}
+			if (!same) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Test: the waveform database answers value-at-time, toggle-count and transition queries like a linear scan of the 
+// changes recorded, before and after it is saved and mapped back in. Records Nodes with no changes but the $dumpvars
+// value, one change, and 63 to 300 changes (so the queries cross the blocks of the sparse index), several of them at
+// the same time, and queries every change time, the times next to it, and times before the first and after the last
+// change. Then checks the database written by a Timing Simulation against its VCD. 
+bool TestWaveformDatabase() {
+	const int changeCnts[6] = {0, 1, 63, 64, 65, 300};
+	vector<Node> nodeStore;
+	vector<Node*> nodes;
+	for (int n = 0; n < 6; n++) {
+		nodeStore.push_back(Node("Node" + to_string(n), n));
+	}
+	for (Node& node : nodeStore) {
+		nodes.push_back(&node);
+	}
+	WaveformDatabase db;
+	db.Open("DigiSim Test", nodes);
+	vector<vector<pair<long long, char>>> changes(6);
+	mt19937 rng(25);
+	long long time = 0;
+	for (int n = 0; n < 6; n++) {
+		db.Record(0, n, '0');
+		changes[n].push_back(make_pair(0LL, '0'));
+	}
+	for (bool more = true; more; ) {
+		time += 1 + rng() % 20;
+		more = false;
+		for (int n = 0; n < 6; n++) {
+			if ((int)changes[n].size() <= changeCnts[n] && rng() % 3 != 0) {
+				char value = (changes[n].back().second == '0') ? '1' : '0';
+				db.Record(time, n, value);
+				changes[n].push_back(make_pair(time, value));
+			}
+			more = more || (int)changes[n].size() <= changeCnts[n];
+		}
+	}
+	db.Finish();
+	vector<long long> queryTimes = {-100, -1, time + 1, time + 1000, numeric_limits<long long>::max()/2};
+	for (int n = 0; n < 6; n++) {
+		for (const pair<long long, char>& change : changes[n]) {
+			queryTimes.insert(queryTimes.end(), {change.first - 1, change.first, change.first + 1});
+		}
+	}
+	for (int loaded = 0; loaded < 2; loaded++) {
+		if (loaded && (!db.Save("test_waveform.wdb") || !db.Load("test_waveform.wdb"))) {
+			printf("FAIL waveform database: the database does not save and load\n");
+			return false;
+		}
+		for (int n = 0; n < 6; n++) {
+			if (db.Find(nodes[n]->name) != n || !CheckWaveformQueries(db, n, changes[n], queryTimes)) {
+				printf("FAIL waveform database: a query on Node %d (%d changes) of the %s database differs from a "
+				       "linear scan\n", n, changeCnts[n], loaded ? "loaded" : "recorded");
+				return false;
+			}
+		}
+	}
+
+	// the database of a Timing Simulation holds the values of its VCD
+	string netlist = "test_netlist.txt", stimulus = "test_input.txt";
+	WriteRandomTestCase(netlist, stimulus, 25);
+	RunTestCircuit(netlist, [&](Circuit& C) {
+		WaveformOptions options;
+		options.database = true;
+		C.SetWaveformOptions(options);
+		C.TimingSimulation(stimulus);
+	});
+	vector<long long> times;
+	for (long long t = 0; t <= 10000; t++) {
+		times.push_back(t);
+	}
+	string values;
+	if (db.Load("test_timing.wdb")) {
+		vector<pair<string, int>> names; // the Nodes in name order, like VCDValuesAt
+		for (int n = 0; n < db.Nodes(); n++) {
+			names.push_back(make_pair(string(db.Name(n)), n));
+		}
+		sort(names.begin(), names.end());
+		for (long long t : times) {
+			for (const pair<string, int>& name : names) {
+				values += db.ValueAt(name.second, t);
+			}
+			values += "\n";
+		}
+	}
+	db = WaveformDatabase();
+	if (values != VCDValuesAt("test_timing.vcd", times)) {
+		printf("FAIL waveform database: the database of a Timing Simulation differs from its VCD\n");
+		return false;
+	}
+	remove(netlist.c_str());
+	remove(stimulus.c_str());
+	remove("test_timing.vcd");
+	remove("test_timing.wdb");
+	remove("test_waveform.wdb");
+	printf("PASS waveform database\n");
+	return true;
+}
+
+// This Function runs every regression test. Returns 0 if they all pass and 1 otherwise. 
+int RunTests() {
+	int failCnt = 0;
+	failCnt += !TestSameTimeInputs();
+	failCnt += !TestEngineWaveforms();
+	failCnt += !TestCompressedWaveforms();
+	failCnt += !TestCycleEngine();
+	failCnt += !TestBatchReset();
+	failCnt += !TestWaveformDatabase();
+	printf("%s\n", (failCnt == 0) ? "All tests passed" : (to_string(failCnt) + " test(s) FAILED").c_str());
+	return (failCnt == 0) ? 0 : 1;
+}
+
+
+// MAIN
+int main(int argc, char *argv[]) {
+	// Read command line options. 
+	//   --bench <name>                      run a built-in benchmark instead of the interactive prompts
+	//   --test                              run the built-in regression tests instead of the interactive prompts
+	//   --scheduler heap|wheel              select the Event Queue scheduler for simulations (default heap)
+	//   --engine event|levelized|compiled|cycle   select the Functional Simulation engine (default event)
+	//   --dump-cycles                       write the waveform of the cycle-based Functional Simulation
+	//   --threads <n>                       worker threads of --batch (default: all cores)
+	//   --no-netlist-images                 always read the netlist text (do not load or save netlist images)
+	//   --async-waveform                    format and write waveforms on a writer thread
+	//   --waveform vcd|dsw                  write waveforms as VCD (default) or compressed waveforms (.dsw)
+	//   --to-vcd <waveform> <vcd>           convert a compressed waveform to VCD instead of the interactive prompts
+	//   --waveform-db                       also record waveforms into waveform databases (.wdb)
+	//   --query <db> <node> <from> <to>     print a Node's value, toggles and changes in a time range from a 
+	//                                       waveform database instead of the interactive prompts
+	//   --dump <pattern>                    dump only Nodes matching the glob (* and ?), or @inputs, @outputs, @dffs
+	//   --dump-regex <regex>                dump only Nodes whose whole name matches the regular expression
+	//   --dump-window <from> <to>           dump only from time <from> to time <to> (all three may be repeated)
+	//   --batch <netlist> <list>            run a Functional Simulation of each input file listed (one per line) in the 
+	//                                       list file on the netlist instead of the interactive prompts
+	SchedulerType scheduler = HEAP_SCHEDULER;
+	FunctionalEngine engine = EVENT_ENGINE;
+	bool dumpCycles = false;
+	bool images = true;
+	WaveformOptions waveform;
+	int threadCnt = max(1, (int)thread::hardware_concurrency());
+	string batchNetlist, batchList;
+	for (int i = 1; i < argc; i++) {
+		string option = argv[i];
+		string value = (i + 1 < argc) ? argv[i + 1] : "";
+		if (option == "--bench" && !value.empty()) {
+			return RunBenchmark(value);
+		}
+		else if (option == "--test") {
+			return RunTests();
+		}
+		else if (option == "--scheduler" && (value == "heap" || value == "wheel")) {
+			scheduler = (value == "wheel") ? WHEEL_SCHEDULER : HEAP_SCHEDULER;
+			i++;
+		}
+		else if (option == "--engine" && (value == "event" || value == "levelized" || value == "compiled" || 
+		                                   value == "cycle")) {
+			engine = (value == "cycle") ? CYCLE_ENGINE : (value == "compiled") ? COMPILED_ENGINE : 
+			         (value == "levelized") ? LEVELIZED_ENGINE : EVENT_ENGINE;
+			i++;
+		}
+		else if (option == "--dump-cycles") {
+			dumpCycles = true;
+		}
+		else if (option == "--threads" && atoi(value.c_str()) > 0) {
+			threadCnt = atoi(value.c_str());
+			i++;
+		}
+		else if (option == "--no-netlist-images") {
+			images = false;
+		}
+		else if (option == "--async-waveform") {
+			waveform.async = true;
+		}
+		else if (option == "--waveform" && (value == "vcd" || value == "dsw")) {
+			waveform.compressed = (value == "dsw");
+			i++;
+		}
+		else if (option == "--dump" && !value.empty()) {
+			waveform.dumpPatterns.push_back(value);
+			i++;
+		}
+		else if (option == "--dump-regex" && !value.empty()) {
+			try {
+				regex check(value);
+			}
+			catch (const regex_error& e) {
+				cerr << "Error: bad --dump-regex " << value << ": " << e.what() << endl;
+				return 1;
+			}
+			waveform.dumpRegexes.push_back(value);
+			i++;
+		}
+		else if (option == "--dump-window" && i + 2 < argc && atoll(argv[i + 2]) > atoll(argv[i + 1])) {
+			waveform.dumpWindows.push_back(make_pair(atoll(argv[i + 1]), atoll(argv[i + 2])));
+			i += 2;
+		}
+		else if (option == "--waveform-db") {
+			waveform.database = true;
+		}
+		else if (option == "--query" && i + 4 < argc) {
+			return QueryWaveformDatabase(argv[i + 1], argv[i + 2], atoll(argv[i + 3]), atoll(argv[i + 4])) ? 0 : 1;
+		}
+		else if (option == "--to-vcd" && i + 2 < argc) {
+			if (!ConvertWaveformToVCD(argv[i + 1], argv[i + 2])) {
+				cerr << "Error: " << argv[i + 1] << " is not a complete compressed waveform" << endl;
+				return 1;
+			}
+			cout << "Waveform converted, stored in " << argv[i + 2] << endl;
+			return 0;
+		}
+		else if (option == "--batch" && i + 2 < argc) {
+			batchNetlist = argv[i + 1];
+			batchList = argv[i + 2];
+			i += 2;
+		}
+		else {
+			cerr << "Unknown option " << option << endl;
+			cerr << "Usage: digisim [--scheduler heap|wheel] [--engine event|levelized|compiled|cycle] [--dump-cycles] "
+			     << "[--threads <n>] [--no-netlist-images] [--async-waveform] "
+			     << "[--waveform vcd|dsw] [--dump <pattern>] [--dump-regex <regex>] [--dump-window <from> <to>] "
+			     << "[--waveform-db] [--bench <name>] [--test] [--batch <netlist> <list>] [--to-vcd <waveform> <vcd>] "
+			     << "[--query <db> <node> <from> <to>]" << endl;
+			return 1;
+		}
+	}
+
+	// Run a batch of Functional Simulations on one netlist (summary written to BatchSummary.txt)
+	if (!batchNetlist.empty()) {
+		vector<string> inputFiles;
+		MappedFile ListFile(batchList);
+		TextScanner list(ListFile.Text());
+		while (list.NextLine()) {
+			string_view inputFile = list.Token();
+			if (!inputFile.empty()) {
+				inputFiles.push_back(string(inputFile));
+			}
+		}
+		shared_ptr<const Netlist> net = make_shared<const Netlist>(batchNetlist, images);
+		cout << "Circuit Netlist Mapped" << endl;
+		FunctionalSimulationBatch(net, inputFiles, scheduler, engine, dumpCycles, waveform, threadCnt, 
+		                          "BatchSummary.txt");
+		return 0;
+	}
 
-// MAIN
-int main(int argc, char *argv[]) {
 	// Retrieve circuit netlist file
 	string netlistFile;
 	cout << "Enter netlist file: " << endl;
@@ -1936,7 +7394,9 @@ int main(int argc, char *argv[]) {
 		cin >> inputFile;
 
 		// Create Timing Sim Circuit
-		Circuit *CircuitTestSim = new Circuit(netlistFile);
+		Circuit *CircuitTestSim = new Circuit(netlistFile, images);
+		CircuitTestSim->SetScheduler(scheduler);
+		CircuitTestSim->SetWaveformOptions(waveform);
 		// Run Timing Sim
 		CircuitTestSim->TimingSimulation(inputFile);
 		// Delete Timing Sim Circuit
@@ -1968,9 +7428,11 @@ int main(int argc, char *argv[]) {
 			cin >> inputFile;
 
 			// Create Functional Sim Circuit
-			Circuit  *CircuitTestFunc = new Circuit(netlistFile);
+			Circuit  *CircuitTestFunc = new Circuit(netlistFile, images);
+			CircuitTestFunc->SetScheduler(scheduler);
+			CircuitTestFunc->SetWaveformOptions(waveform);
 			// Run Functional Sim
-			CircuitTestFunc->FunctionalSimulation(inputFile);
+			CircuitTestFunc->FunctionalSimulation(inputFile, engine, dumpCycles);
 			// Delete Functional Sim Circuit
 			delete CircuitTestFunc;
 		}
@@ -1993,7 +7455,7 @@ int main(int argc, char *argv[]) {
 			// if user responds 'yes' then execute fault vector gen.
 			if (fault_response == "y") {
 				// Create FaultVectorGenerator
-				FaultVectorGenerator *Generator = new FaultVectorGenerator(netlistFile);
+				FaultVectorGenerator *Generator = new FaultVectorGenerator(netlistFile, images);
 				// Ask for coverage constraint
 				double coverage_constraint = -1;
 				while (coverage_constraint < 0 or coverage_constraint > 100) {